@@ -0,0 +1,287 @@
+#include <random>
+
+// Synthetic camera frame with planes laid out like YUV_420_888 with padded rows
+struct Benchmark_Frame {
+  int width;
+  int height;
+  int yRowStride;
+  int uvRowStride;
+
+  std::vector<unsigned char> yPlane;
+  std::vector<unsigned char> uvPlane;
+
+  void create(int width_, int height_) {
+    width = width_;
+    height = height_;
+    yRowStride = (width + 63) / 64 * 64;
+    uvRowStride = yRowStride;
+
+    yPlane.assign((size_t)yRowStride * height, 40);
+    uvPlane.assign((size_t)uvRowStride * (height / 2), 128);
+
+    // Shapes with strong edges
+    cv::Mat yImage(height, width, CV_8UC1, yPlane.data(), yRowStride);
+    std::mt19937 random(123);
+
+    for (int i = 0; i < 200; ++i) {
+      const cv::Point center(random() % width, random() % height);
+      const int size = 10 + random() % (width / 8);
+      const cv::Scalar color(60 + random() % 196);
+
+      if (i % 2 == 0) {
+        cv::rectangle(yImage, cv::Rect(center.x, center.y, size, size / 2), color, -1);
+      }
+      else {
+        cv::circle(yImage, center, size / 2, color, -1);
+      }
+    }
+  }
+
+  size_t getNV21Size() const {
+    return (size_t)width * height * 3 / 2;
+  }
+
+  void ingest(unsigned char *nv21ImageData, Stripe_Pipeline *stripePipeline) const {
+    ingestImageBuffers(nv21ImageData, width, height,
+                       yPlane.data(), width * height, 1, yRowStride,
+                       uvPlane.data(), 1, uvRowStride, 1,
+                       nullptr, stripePipeline);
+  }
+};
+
+// Native benchmarks, results are logged
+class Benchmark {
+public:
+  int frames = 30;
+
+  void run() {
+    runStripedLatency(1280, 720);
+    runStripedLatency(1920, 1080);
+    runTileFusion(1920, 1080);
+    runTileFusion(3840, 2160);
+    runQualityTiers(1280, 720);
+    runQualityTiers(1920, 1080);
+  }
+
+  // Frame latency of copy then detect against detecting stripes during copy
+  void runStripedLatency(int width, int height) {
+    Benchmark_Frame frame;
+    frame.create(width, height);
+
+    std::vector<unsigned char> nv21ImageData(frame.getNV21Size());
+    Stripe_Pipeline stripePipeline;
+    stripePipeline.start();
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Striped latency %dx%d, %d frames", width, height, frames);
+
+    std::vector<std::pair<const char*, Detector*>> detectors = getDetectors(width, height);
+
+    for (auto &item : detectors) {
+      Detector *detector = item.second;
+
+      // Modes that need color input fail on the luma plane
+      try {
+        // Serial leg is the serial preview path, both take the luma plane through setImageData
+        const double serialMs = measure([&] {
+          frame.ingest(nv21ImageData.data(), nullptr);
+          detector->setImageData(nv21ImageData.data());
+          detector->detect();
+        });
+
+        const double stripedMs = measure([&] {
+          detector->setImageData(nv21ImageData.data());
+          detector->prepareStripes();
+          stripePipeline.beginFrame(detector);
+          frame.ingest(nv21ImageData.data(), &stripePipeline);
+          stripePipeline.endFrame();
+        });
+
+        __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  %-10s serial %7.2f ms, striped %7.2f ms, speedup %.2fx",
+                            item.first, serialMs, stripedMs, stripedMs > 0.0 ? serialMs / stripedMs : 0.0);
+      }
+      catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  %-10s skipped: %s", item.first, e.what());
+      }
+
+      delete detector;
+    }
+  }
+
+  // Stage by stage against tiled execution of image modes
+  // Main memory read traffic is estimated from last level cache read misses when the event is available
+  void runTileFusion(int width, int height) {
+    Benchmark_Frame frame;
+    frame.create(width, height);
+
+    std::vector<unsigned char> nv21ImageData(frame.getNV21Size());
+    frame.ingest(nv21ImageData.data(), nullptr);
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Tile fusion %dx%d, %d frames", width, height, frames);
+
+    std::vector<std::pair<const char*, Detector*>> detectors = getDetectors(width, height);
+    const int threadCount = cv::getNumThreads();
+
+    for (auto &item : detectors) {
+      Detector_Edges_Image *detector = dynamic_cast<Detector_Edges_Image*>(item.second);
+
+      if (detector != nullptr) {
+        // Modes that need color input fail on the luma plane
+        try {
+          detector->setImageData(nv21ImageData.data());
+
+          auto detectFrame = [detector] { detector->detect(); };
+
+          // Single thread so counters of this thread see all work
+          // Thread count is process wide, other detection is paused during benchmark
+          cv::setNumThreads(1);
+
+          detector->tiledExecution = false;
+          double stageTrafficMB;
+          const double stageMs = measure(detectFrame, &stageTrafficMB);
+
+          detector->tiledExecution = true;
+          double tiledTrafficMB;
+          const double tiledMs = measure(detectFrame, &tiledTrafficMB);
+
+          cv::setNumThreads(threadCount);
+
+          detector->tiledExecution = false;
+          const double stageParallelMs = measure(detectFrame);
+
+          detector->tiledExecution = true;
+          const double tiledParallelMs = measure(detectFrame);
+
+          // Lower bound is reading source once and processed image lines once on write allocate
+          const double minimumTrafficMB = (double)width * height * (1 + detector->processedImage.channels()) / (1024.0 * 1024.0);
+
+          char trafficText[128] = "LLC read miss traffic n/a";
+          if (stageTrafficMB >= 0.0 && tiledTrafficMB >= 0.0) {
+            snprintf(trafficText, sizeof(trafficText), "LLC read miss traffic %.1f MB -> %.1f MB (min %.1f MB)", stageTrafficMB, tiledTrafficMB, minimumTrafficMB);
+          }
+
+          __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  %-10s 1 thread %7.2f -> %7.2f ms (%.2fx), %d threads %7.2f -> %7.2f ms (%.2fx), %s",
+                              item.first,
+                              stageMs, tiledMs, tiledMs > 0.0 ? stageMs / tiledMs : 0.0,
+                              threadCount, stageParallelMs, tiledParallelMs, tiledParallelMs > 0.0 ? stageParallelMs / tiledParallelMs : 0.0,
+                              trafficText);
+        }
+        catch (const std::exception& e) {
+          cv::setNumThreads(threadCount);
+          __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  %-10s skipped: %s", item.first, e.what());
+        }
+      }
+
+      delete item.second;
+    }
+  }
+
+  // Speed of each quality tier and agreement of its edges with full Canny
+  void runQualityTiers(int width, int height) {
+    Benchmark_Frame frame;
+    frame.create(width, height);
+
+    std::vector<unsigned char> nv21ImageData(frame.getNV21Size());
+    frame.ingest(nv21ImageData.data(), nullptr);
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Quality tiers %dx%d, %d frames", width, height, frames);
+
+    // White mode output is the edge image
+    Detector_Edges_Image_White detector;
+    detector.setImageSize(width, height);
+    detector.init();
+    detector.setImageData(nv21ImageData.data());
+
+    cv::Mat cannyEdges;
+    double cannyMs = 0.0;
+
+    for (int tier = 0; tier < EDGE_QUALITY_COUNT; ++tier) {
+      detector.setQualityTier(tier);
+
+      const double ms = measure([&detector] { detector.detect(); });
+
+      if (tier == EDGE_QUALITY_CANNY) {
+        cannyEdges = detector.processedImage.clone();
+        cannyMs = ms;
+      }
+
+      __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  %-12s %7.2f ms, speedup %.2fx, F-measure %.3f",
+                          edgeQualityTierNames[tier], ms, ms > 0.0 ? cannyMs / ms : 0.0,
+                          getFMeasure(detector.processedImage, cannyEdges));
+    }
+  }
+
+protected:
+  std::vector<std::pair<const char*, Detector*>> getDetectors(int width, int height) {
+    std::vector<std::pair<const char*, Detector*>> detectors;
+    detectors.push_back(std::make_pair("white", (Detector*)new Detector_Edges_Image_White()));
+    detectors.push_back(std::make_pair("red", (Detector*)new Detector_Edges_Image_Red()));
+    detectors.push_back(std::make_pair("green", (Detector*)new Detector_Edges_Image_Green()));
+    detectors.push_back(std::make_pair("blue", (Detector*)new Detector_Edges_Image_Blue()));
+    detectors.push_back(std::make_pair("grayscale", (Detector*)new Detector_Edges_Image_Grayscale()));
+    detectors.push_back(std::make_pair("background", (Detector*)new Detector_Edges_Image_Background()));
+    detectors.push_back(std::make_pair("points", (Detector*)new Detector_Edges_Points()));
+
+    for (auto &item : detectors) {
+      item.second->setImageSize(width, height);
+      item.second->init();
+    }
+
+    return detectors;
+  }
+
+  // Harmonic mean of precision and recall, edges within one pixel match
+  double getFMeasure(const cv::Mat &edges, const cv::Mat &referenceEdges) {
+    cv::Mat nearEdges;
+    cv::Mat nearReferenceEdges;
+    cv::Mat matched;
+
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+    cv::dilate(edges, nearEdges, kernel);
+    cv::dilate(referenceEdges, nearReferenceEdges, kernel);
+
+    const int edgeCount = cv::countNonZero(edges);
+    const int referenceCount = cv::countNonZero(referenceEdges);
+
+    if (edgeCount == 0 || referenceCount == 0) {
+      return edgeCount == referenceCount ? 1.0 : 0.0;
+    }
+
+    cv::bitwise_and(edges, nearReferenceEdges, matched);
+    const double precision = (double)cv::countNonZero(matched) / edgeCount;
+
+    cv::bitwise_and(referenceEdges, nearEdges, matched);
+    const double recall = (double)cv::countNonZero(matched) / referenceCount;
+
+    return precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+  }
+
+  // Average milliseconds per frame after one warm up frame
+  // Last level cache read miss traffic per frame in MB is set if given, -1 when the event is not available
+  double measure(const std::function<void()> &frameFunction, double *trafficMB = nullptr) {
+    frameFunction();
+
+    Profiler_Counters &counters = profiler.getThreadCounters();
+    Profiler_Sample startSample;
+    Profiler_Sample endSample;
+    bool hasCounters = trafficMB != nullptr && counters.open() && counters.isAvailable(PROFILER_COUNTER_LLC_READ_MISSES) && counters.read(startSample);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < frames; ++i) {
+      frameFunction();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    if (trafficMB != nullptr) {
+      uint64_t counterDeltas[PROFILER_COUNTER_COUNT];
+      bool scaled;
+      hasCounters = hasCounters && counters.read(endSample) && Profiler_Counters::getDeltas(startSample, endSample, counterDeltas, scaled);
+
+      // Every miss reads one 64 byte cache line from memory
+      *trafficMB = hasCounters ? counterDeltas[PROFILER_COUNTER_LLC_READ_MISSES] * 64.0 / frames / (1024.0 * 1024.0) : -1.0;
+    }
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+  }
+};
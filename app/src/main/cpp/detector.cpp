@@ -5,20 +5,136 @@ public:
 
   std::vector<cv::KeyPoint> keypoints; // Detected points
 
+  int imageWidth = 0;
+  int imageHeight = 0;
+
+  virtual ~Detector() {}
+
   virtual void init() {}
 
+  void setImageSize(int width, int height) {
+    imageWidth = width;
+    imageHeight = height;
+  }
+
+  // Luma plane of NV21 image is the grayscale image, used without copy or conversion
+  // Rows can still be arriving when stripes are detected
   virtual void setImageData(unsigned char* nv21ImageData) {
-    // Create image
-    currentImage.create(cameraHeight, cameraWidth, CV_8UC1);
+    currentImage = cv::Mat(imageHeight, imageWidth, CV_8UC1, nv21ImageData);
+  }
 
-    // Use NV21 image data
-    currentImage.data = nv21ImageData;
+  virtual void detect() {}
+
+  // Striped detection, stripes are detected top to bottom once their rows and halo are ingested
+  // Prepare is called on ingesting thread before the frame is ingested, others on stripe thread
+  virtual void prepareStripes() {}
+  virtual void beginStripes() {}
+  virtual void detectStripe(const cv::Rect &stripe) {}
+  virtual void endStripes() {}
 
-    // Convert image to grayscale
-    cv::cvtColor(currentImage, currentImage, cv::COLOR_BGR2RGB);
+  // Edge result packed to 1 bit per pixel, null for point detectors
+  virtual Edge_Mask* getEdgeMask() {
+    return nullptr;
   }
 
-  virtual void detect() {}
+  // Detect only inside regions and their halo, empty regions is the whole image
+  void setRegions(const std::vector<cv::Rect> &regions_) {
+    std::lock_guard<std::mutex> lock(regionsMutex);
+    regions = regions_;
+    regionMask.release();
+  }
+
+  // Set regions from low resolution binary mask, every non-zero cell is detected
+  // Mask is scaled to the size of each frame when it is detected
+  void setRegionMask(const cv::Mat &mask) {
+    std::lock_guard<std::mutex> lock(regionsMutex);
+    regions.clear();
+    regionMask = mask.clone();
+  }
+
+  // Merge non-zero mask cells to rects, mask covers maskWidth x maskHeight pixels
+  static std::vector<cv::Rect> getMaskRegions(const cv::Mat &mask, int maskWidth, int maskHeight) {
+    std::vector<cv::Rect> cellRegions;
+
+    for (int y = 0; y < mask.rows; ++y) {
+      const unsigned char *maskRow = mask.ptr<unsigned char>(y);
+      size_t rowRegionsStart = cellRegions.size();
+      int x = 0;
+
+      while (x < mask.cols) {
+        if (!maskRow[x]) {
+          ++x;
+          continue;
+        }
+
+        int runStart = x;
+        while (x < mask.cols && maskRow[x]) {
+          ++x;
+        }
+
+        // Extend region above if it has the same columns
+        bool extended = false;
+        for (size_t i = 0; i < rowRegionsStart; ++i) {
+          cv::Rect &cellRegion = cellRegions[i];
+          if (cellRegion.x == runStart && cellRegion.width == x - runStart && cellRegion.y + cellRegion.height == y) {
+            ++cellRegion.height;
+            extended = true;
+            break;
+          }
+        }
+
+        if (!extended) {
+          cellRegions.push_back(cv::Rect(runStart, y, x - runStart, 1));
+        }
+      }
+    }
+
+    // Scale cells to mask image size
+    std::vector<cv::Rect> imageRegions;
+    for (const cv::Rect &cellRegion : cellRegions) {
+      const int x0 = cellRegion.x * maskWidth / mask.cols;
+      const int y0 = cellRegion.y * maskHeight / mask.rows;
+      const int x1 = (cellRegion.x + cellRegion.width) * maskWidth / mask.cols;
+      const int y1 = (cellRegion.y + cellRegion.height) * maskHeight / mask.rows;
+      imageRegions.push_back(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+    }
+
+    return imageRegions;
+  }
+
+  bool hasRegions() {
+    std::lock_guard<std::mutex> lock(regionsMutex);
+    return !regions.empty() || !regionMask.empty();
+  }
+
+  void setFrameStats(const Frame_Stats *frameStats_) {
+    frameStats = frameStats_;
+  }
+
+  // Regions of current frame, non-flat tiles if skipping flat tiles without regions
+  // Falls back to whole image when every tile is flat
+  std::vector<cv::Rect> getFrameRegions() {
+    std::vector<cv::Rect> frameRegions;
+
+    {
+      std::lock_guard<std::mutex> lock(regionsMutex);
+      frameRegions = regionMask.empty() ? regions : getMaskRegions(regionMask, currentImage.cols, currentImage.rows);
+    }
+
+    if (frameRegions.empty() && skipFlatTiles && frameStats != nullptr && frameStats->isValid()) {
+      frameRegions = getMaskRegions(frameStats->getDetailMask(flatTileVariance),
+                                    frameStats->tileColumns * Frame_Stats::tileSize,
+                                    frameStats->tileRows * Frame_Stats::tileSize);
+    }
+
+    return frameRegions;
+  }
+
+  // Region grown by halo and clipped to image
+  cv::Rect expandRegion(const cv::Rect &region, int halo) const {
+    const cv::Rect expanded(region.x - halo, region.y - halo, region.width + halo * 2, region.height + halo * 2);
+    return expanded & cv::Rect(0, 0, currentImage.cols, currentImage.rows);
+  }
 
   void setRenderer(Renderer *renderer_) {
     renderer = renderer_;
@@ -39,6 +155,29 @@ public:
     processedImage.release();
   }
 
+  int regionHalo = 8; // Extra pixels around regions for edge continuity
+  bool cachedRegionBackground = false; // Keep last whole image outside regions instead of clearing it
+
+  bool tiledExecution = false; // Run whole image pipeline tile by tile in cache
+  std::atomic<int> qualityTier{EDGE_QUALITY_CANNY}; // Edge operator of image modes
+
+  // Switch edge operator, takes effect from next frame
+  void setQualityTier(int tier) {
+    if (tier >= 0 && tier < EDGE_QUALITY_COUNT) {
+      qualityTier = tier;
+    }
+  }
+
+  bool autoThresholds = false; // Canny thresholds from frame median
+  bool skipFlatTiles = false; // Detect only tiles with luma variance
+  float flatTileVariance = 25.0f;
+
 protected:
   Renderer *renderer;
+
+  std::mutex regionsMutex;
+  std::vector<cv::Rect> regions;
+  cv::Mat regionMask; // Used instead of regions when set
+
+  const Frame_Stats *frameStats = nullptr; // Statistics from ingestion, null if not computed
 };
@@ -1,22 +1,254 @@
+// Per thread buffers reused between tiles so tile intermediates stay in L2 cache
+// Each buffer keeps one type and only grows, views of the needed size are used
+struct Tile_Scratch {
+  cv::Mat edges; // CV_8UC1 edge image
+  cv::Mat zeros; // CV_8UC1 empty color channel
+  cv::Mat colors; // CV_8UC3 colored edges
+  cv::Mat output; // CV_8UC3 renderer image
+
+  static cv::Mat view(cv::Mat &buffer, int rows, int cols, int type, bool zeroed = false) {
+    if (buffer.rows < rows || buffer.cols < cols || buffer.type() != type) {
+      buffer.create(std::max(rows, buffer.rows), std::max(cols, buffer.cols), type);
+
+      if (zeroed) {
+        buffer.setTo(0);
+      }
+    }
+
+    return buffer(cv::Rect(0, 0, cols, rows));
+  }
+};
+
+static thread_local Tile_Scratch tileScratch;
+
 class Detector_Edges_Image : public Detector_Edges {
 public:
+  // Tile size for tiled execution, about 16 bytes of intermediates per pixel fit 256 KB
+  int tileWidth = 256;
+  int tileHeight = 64;
+
   void detect() override {
+    const std::vector<cv::Rect> frameRegions = getFrameRegions();
+
+    updateThresholds();
+    frameQualityTier = qualityTier;
+
+    if (frameRegions.empty() && tiledExecution) {
+      detectTiles();
+      ++fullImageVersion;
+    }
+    else if (frameRegions.empty()) {
+      detectImage(currentImage, processedImage);
+      ++fullImageVersion;
+    }
+    else {
+      detectRegions(frameRegions);
+    }
+
+    renderedRegions = frameRegions;
+  }
+
+  // Frame stats are updated by ingestion so thresholds are taken before it starts
+  void prepareStripes() override {
+    updateThresholds();
+    frameQualityTier = qualityTier;
+  }
+
+  void detectStripe(const cv::Rect &stripe) override {
+    const cv::Mat inner = detectRegion(stripe, stripeImage);
+
+    // Stripes cover whole image so it does not need clearing
+    processedImage.create(currentImage.rows, currentImage.cols, inner.type());
+    inner.copyTo(processedImage(stripe));
+  }
+
+  void endStripes() override {
+    renderedRegions.clear();
+    ++fullImageVersion;
+  }
+
+  // Detect edges from source image and write renderer image to output
+  void detectImage(const cv::Mat &source, cv::Mat &output) {
     cv::Mat image;
+    detectImage(source, output, image);
+  }
 
-    // Detect edges from current image and add them to blank image
-    cv::Canny(currentImage, image, 80, 90);
+  // Detect using image as buffer for intermediate results
+  // Tiles run on parallel threads and are profiled as one tiled stage instead
+  void detectImage(const cv::Mat &source, cv::Mat &output, cv::Mat &image, bool profiled = true) {
+    {
+      Profiler_Scope scope(PROFILER_STAGE_DETECT, profiled);
 
-    // Process image
-    processImage(image);
+      // Detect edges from source image and add them to blank image
+      switch (frameQualityTier) {
+        case EDGE_QUALITY_SOBEL:
+          detectEdgesSobel(source, image, sobelThreshold);
+          break;
+        case EDGE_QUALITY_GRADIENT_LUT:
+          detectEdgesGradientLut(source, image, gradientLut);
+          break;
+        default:
+          cv::Canny(source, image, lowThreshold, highThreshold);
+      }
+    }
 
-    // Convert processed image to RGB
-    cv::cvtColor(processedImage, processedImage, cv::COLOR_BGR2RGB);
+    {
+      Profiler_Scope scope(PROFILER_STAGE_COLORIZE, profiled);
+
+      // Process image
+      processImage(image, source);
+    }
+
+    {
+      Profiler_Scope scope(PROFILER_STAGE_UPLOAD_PREP, profiled);
+
+      // Convert processed image for renderer
+      convertImage(image, output);
+    }
   }
 
   void updateRendererData() override {
     // Update renderer image
+    renderer->setImageRegions(renderedRegions, fullImageVersion);
     renderer->setImageData(processedImage.data);
   }
 
-  virtual void processImage(cv::Mat &image) {}
+  // Mask of non-zero processed image pixels
+  Edge_Mask* getEdgeMask() override {
+    if (processedImage.channels() == 1) {
+      outputMask.pack(processedImage);
+    }
+    else {
+      cv::Mat grayImage;
+      cv::cvtColor(processedImage, grayImage, cv::COLOR_RGB2GRAY);
+      outputMask.pack(grayImage);
+    }
+
+    return &outputMask;
+  }
+
+  virtual void processImage(cv::Mat &image, const cv::Mat &source) {}
+
+  virtual void convertImage(cv::Mat &image, cv::Mat &output) {
+    // Convert processed image to RGB
+    cv::cvtColor(image, output, cv::COLOR_BGR2RGB);
+  }
+
+protected:
+  std::vector<cv::Rect> renderedRegions; // Regions of last processed image
+  int64_t fullImageVersion = 0; // Changes when whole processed image is rewritten
+
+  double lowThreshold = 80;
+  double highThreshold = 90;
+
+  int frameQualityTier = EDGE_QUALITY_CANNY; // Tier of current frame, taken once so tiles and stripes agree
+
+  int sobelThreshold = 85; // Single threshold of cheaper tiers
+  unsigned char gradientLut[256];
+
+  Edge_Mask outputMask;
+  cv::Mat stripeImage;
+
+  void updateThresholds() {
+    // Canny thresholds from median luma
+    if (autoThresholds && frameStats != nullptr && frameStats->isValid()) {
+      const double median = frameStats->median();
+      lowThreshold = std::max(0.0, 0.66 * median);
+      highThreshold = std::min(255.0, 1.33 * median);
+    }
+    else {
+      lowThreshold = 80;
+      highThreshold = 90;
+    }
+
+    // Without hysteresis threshold is between low and high
+    // Central differences are about a quarter of Sobel magnitude
+    sobelThreshold = (int)((lowThreshold + highThreshold) / 2);
+    buildGradientLut(gradientLut, sobelThreshold / 4);
+  }
+
+  // Run whole pipeline tile by tile, only processed image is written to main memory
+  // Tiles read the wrapped NV21 luma plane in place, there is no convert pass before them
+  // Wall time is profiled for the whole call, counters see the calling thread only
+  void detectTiles() {
+    Profiler_Scope scope(PROFILER_STAGE_TILED);
+
+    std::vector<cv::Rect> tiles;
+
+    for (int y = 0; y < currentImage.rows; y += tileHeight) {
+      for (int x = 0; x < currentImage.cols; x += tileWidth) {
+        tiles.push_back(cv::Rect(x, y, std::min(tileWidth, currentImage.cols - x), std::min(tileHeight, currentImage.rows - y)));
+      }
+    }
+
+    // First tile gives processed image type
+    detectTile(tiles[0], true);
+
+    cv::parallel_for_(cv::Range(1, tiles.size()), [this, &tiles](const cv::Range &range) {
+      for (int i = range.start; i < range.end; ++i) {
+        detectTile(tiles[i], false);
+      }
+    });
+  }
+
+  void detectTile(const cv::Rect &tile, bool createProcessedImage) {
+    const cv::Rect expanded = expandRegion(tile, regionHalo);
+
+    // Operations write views of matching size and type in place, headers may be replaced by modes
+    cv::Mat image = Tile_Scratch::view(tileScratch.edges, expanded.height, expanded.width, CV_8UC1);
+    cv::Mat output = Tile_Scratch::view(tileScratch.output, expanded.height, expanded.width, CV_8UC3);
+    detectImage(currentImage(expanded), output, image, false);
+
+    const cv::Mat inner = output(cv::Rect(tile.x - expanded.x, tile.y - expanded.y, tile.width, tile.height));
+
+    if (createProcessedImage) {
+      processedImage.create(currentImage.rows, currentImage.cols, inner.type());
+    }
+
+    inner.copyTo(processedImage(tile));
+  }
+
+  // Detect region with halo, returns part of region image without halo
+  cv::Mat detectRegion(const cv::Rect &region, cv::Mat &regionImage) {
+    const cv::Rect expanded = expandRegion(region, regionHalo);
+    detectImage(currentImage(expanded), regionImage);
+
+    return regionImage(cv::Rect(region.x - expanded.x, region.y - expanded.y, region.width, region.height));
+  }
+
+  void detectRegions(const std::vector<cv::Rect> &frameRegions) {
+    const cv::Rect imageRect(0, 0, currentImage.cols, currentImage.rows);
+    const bool regionsChanged = frameRegions != renderedRegions || processedImage.rows != currentImage.rows || processedImage.cols != currentImage.cols;
+
+    const bool exposureChanged = frameStats != nullptr && frameStats->exposureChanged;
+
+    if ((regionsChanged || exposureChanged) && cachedRegionBackground) {
+      // Detect whole image once for background
+      detectImage(currentImage, processedImage);
+      ++fullImageVersion;
+      return;
+    }
+
+    bool clearBackground = regionsChanged;
+    cv::Mat regionImage;
+
+    for (const cv::Rect &frameRegion : frameRegions) {
+      const cv::Rect region = frameRegion & imageRect;
+      if (region.empty()) {
+        continue;
+      }
+
+      const cv::Mat inner = detectRegion(region, regionImage);
+
+      if (clearBackground) {
+        // Clear background with region image type
+        processedImage = cv::Mat::zeros(currentImage.rows, currentImage.cols, regionImage.type());
+        ++fullImageVersion;
+        clearBackground = false;
+      }
+
+      // Copy region without halo to processed image
+      inner.copyTo(processedImage(region));
+    }
+  }
 };
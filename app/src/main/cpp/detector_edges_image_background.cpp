@@ -1,13 +1,10 @@
 class Detector_Edges_Image_Background : public Detector_Edges_Image {
 public:
-  void processImage(cv::Mat &image) override {
+  void processImage(cv::Mat &image, const cv::Mat &source) override {
     // Convert image to RGB
     cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
 
-    // Copy edges to current image
-    cv::addWeighted(image, 0.5, currentImage, 0.5, 0, image);
-
-    // Update processed image
-    processedImage = image;
+    // Copy edges to source image
+    cv::addWeighted(image, 0.5, source, 0.5, 0, image);
   }
 };
@@ -1,14 +1,16 @@
 class Detector_Edges_Image_Grayscale : public Detector_Edges_Image {
 public:
-  void processImage(cv::Mat &image) override {
+  Detector_Edges_Image_Grayscale() {
+    // Dilation reaches 10 pixels past edges found in halo
+    regionHalo = 16;
+  }
+
+  void processImage(cv::Mat &image, const cv::Mat &source) override {
     // Make edges thicker
     cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(20, 20));
     cv::dilate(image, image, kernel);
 
-    // Apply pixels from original image to processed image
-    currentImage.copyTo(image, image);
-
-    // Update processed image
-    processedImage = image;
+    // Apply pixels from source image to processed image
+    source.copyTo(image, image);
   }
 };
@@ -1,6 +1,34 @@
 class Detector_Edges_Image_White : public Detector_Edges_Image {
-  void processImage(cv::Mat &image) override {
-    // Update processed image
-    processedImage = image;
+public:
+  Edge_Mask edgeMask; // Edges packed to 1 bit per pixel
+
+  void detect() override {
+    Detector_Edges_Image::detect();
+
+    Profiler_Scope scope(PROFILER_STAGE_UPLOAD_PREP);
+
+    // Pack edges, unpack shader draws them white
+    edgeMask.pack(processedImage);
+  }
+
+  void endStripes() override {
+    Detector_Edges_Image::endStripes();
+
+    Profiler_Scope scope(PROFILER_STAGE_UPLOAD_PREP);
+    edgeMask.pack(processedImage);
+  }
+
+  Edge_Mask* getEdgeMask() override {
+    return &edgeMask;
+  }
+
+  void convertImage(cv::Mat &image, cv::Mat &output) override {
+    // Edges are packed instead of converted to RGB
+    output = image;
+  }
+
+  void updateRendererData() override {
+    // Update renderer edge mask
+    renderer->setEdgeMask(&edgeMask);
   }
 };
@@ -7,8 +7,35 @@ public:
   }
 
   void detect() override {
-    // Create a list to hold the keypoints
-    featureDetector->detect(currentImage, keypoints);
+    Profiler_Scope scope(PROFILER_STAGE_DETECT);
+
+    const std::vector<cv::Rect> frameRegions = getFrameRegions();
+
+    if (frameRegions.empty()) {
+      // Create a list to hold the keypoints
+      featureDetector->detect(currentImage, keypoints);
+      return;
+    }
+
+    keypoints.clear();
+
+    const cv::Rect imageRect(0, 0, currentImage.cols, currentImage.rows);
+
+    for (const cv::Rect &frameRegion : frameRegions) {
+      const cv::Rect region = frameRegion & imageRect;
+      if (!region.empty()) {
+        detectRegion(region);
+      }
+    }
+  }
+
+  void beginStripes() override {
+    keypoints.clear();
+  }
+
+  void detectStripe(const cv::Rect &stripe) override {
+    Profiler_Scope scope(PROFILER_STAGE_DETECT);
+    detectRegion(stripe);
   }
 
   void updateRendererData() override {
@@ -18,4 +45,21 @@ public:
 
 private:
   cv::Ptr<cv::Feature2D> featureDetector;
+  std::vector<cv::KeyPoint> regionKeypoints;
+
+  // Detect region with halo and add keypoints inside region
+  void detectRegion(const cv::Rect &region) {
+    const cv::Rect expanded = expandRegion(region, regionHalo);
+    featureDetector->detect(currentImage(expanded), regionKeypoints);
+
+    // Move keypoints to image coordinates and skip halo
+    for (cv::KeyPoint &keypoint : regionKeypoints) {
+      keypoint.pt.x += expanded.x;
+      keypoint.pt.y += expanded.y;
+
+      if (region.contains(cv::Point((int)keypoint.pt.x, (int)keypoint.pt.y))) {
+        keypoints.push_back(keypoint);
+      }
+    }
+  }
 };
@@ -0,0 +1,240 @@
+// Edge operators of image modes, cheaper tiers trade accuracy for latency
+enum Edge_Quality_Tier {
+  EDGE_QUALITY_CANNY, // Canny with hysteresis
+  EDGE_QUALITY_SOBEL, // Sobel L1 magnitude and non-max suppression with one threshold
+  EDGE_QUALITY_GRADIENT_LUT, // 8-bit central difference gradient through lookup table
+  EDGE_QUALITY_COUNT
+};
+
+static const char* edgeQualityTierNames[EDGE_QUALITY_COUNT] = {
+  "canny", "sobel", "gradient-lut"
+};
+
+// Sobel gradients and L1 magnitude of row y, border pixels are zero
+void sobelRow(const cv::Mat &source, int y, short *gx, short *gy, short *magnitude) {
+  const int width = source.cols;
+
+  if (y <= 0 || y >= source.rows - 1 || width < 3) {
+    memset(gx, 0, width * sizeof(short));
+    memset(gy, 0, width * sizeof(short));
+    memset(magnitude, 0, width * sizeof(short));
+    return;
+  }
+
+  const unsigned char *above = source.ptr<unsigned char>(y - 1);
+  const unsigned char *center = source.ptr<unsigned char>(y);
+  const unsigned char *below = source.ptr<unsigned char>(y + 1);
+
+  gx[0] = gy[0] = magnitude[0] = 0;
+  gx[width - 1] = gy[width - 1] = magnitude[width - 1] = 0;
+
+  int x = 1;
+
+#if defined(__ARM_NEON)
+  for (; x + 9 <= width; x += 8) {
+    const int16x8_t aboveLeft = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x - 1)));
+    const int16x8_t aboveCenter = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x)));
+    const int16x8_t aboveRight = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x + 1)));
+    const int16x8_t left = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(center + x - 1)));
+    const int16x8_t right = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(center + x + 1)));
+    const int16x8_t belowLeft = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x - 1)));
+    const int16x8_t belowCenter = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x)));
+    const int16x8_t belowRight = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x + 1)));
+
+    // Weights 1 2 1 across the derivative
+    int16x8_t dx = vaddq_s16(vsubq_s16(aboveRight, aboveLeft), vsubq_s16(belowRight, belowLeft));
+    dx = vaddq_s16(dx, vshlq_n_s16(vsubq_s16(right, left), 1));
+
+    int16x8_t dy = vaddq_s16(vsubq_s16(belowLeft, aboveLeft), vsubq_s16(belowRight, aboveRight));
+    dy = vaddq_s16(dy, vshlq_n_s16(vsubq_s16(belowCenter, aboveCenter), 1));
+
+    vst1q_s16(gx + x, dx);
+    vst1q_s16(gy + x, dy);
+    vst1q_s16(magnitude + x, vaddq_s16(vabsq_s16(dx), vabsq_s16(dy)));
+  }
+#endif
+
+  // Remaining pixels
+  for (; x < width - 1; ++x) {
+    const int dx = (above[x + 1] - above[x - 1]) + 2 * (center[x + 1] - center[x - 1]) + (below[x + 1] - below[x - 1]);
+    const int dy = (below[x - 1] - above[x - 1]) + 2 * (below[x] - above[x]) + (below[x + 1] - above[x + 1]);
+
+    gx[x] = dx;
+    gy[x] = dy;
+    magnitude[x] = std::abs(dx) + std::abs(dy);
+  }
+}
+
+// Keep pixels above threshold that are local maxima across gradient direction
+// Directions are quantized like cv::Canny, tan(22.5) is 13573 / 2^15
+void suppressRow(const short *gx, const short *gy, const short *above, const short *magnitude, const short *below,
+                 int width, int threshold, unsigned char *edges) {
+  if (width < 3) {
+    memset(edges, 0, width);
+    return;
+  }
+
+  edges[0] = 0;
+  edges[width - 1] = 0;
+
+  int x = 1;
+
+#if defined(__ARM_NEON)
+  const int16x8_t thresholds = vdupq_n_s16(threshold);
+
+  for (; x + 9 <= width; x += 8) {
+    const int16x8_t dx = vld1q_s16(gx + x);
+    const int16x8_t dy = vld1q_s16(gy + x);
+    const int16x8_t m = vld1q_s16(magnitude + x);
+
+    const int16x8_t ax = vabsq_s16(dx);
+    const int16x8_t ay = vabsq_s16(dy);
+    const int16x8_t tan22 = vqdmulhq_n_s16(ax, 13573);
+    const int16x8_t tan67 = vaddq_s16(tan22, vshlq_n_s16(ax, 1));
+
+    // Horizontal gradient compares left and right, vertical compares above and below
+    const uint16x8_t horizontal = vcltq_s16(ay, tan22);
+    const uint16x8_t vertical = vcgtq_s16(ay, tan67);
+
+    const uint16x8_t horizontalMax = vandq_u16(vcgtq_s16(m, vld1q_s16(magnitude + x - 1)), vcgeq_s16(m, vld1q_s16(magnitude + x + 1)));
+    const uint16x8_t verticalMax = vandq_u16(vcgtq_s16(m, vld1q_s16(above + x)), vcgeq_s16(m, vld1q_s16(below + x)));
+
+    // Diagonal direction depends on gradient signs
+    const uint16x8_t oppositeSigns = vcltq_s16(veorq_s16(dx, dy), vdupq_n_s16(0));
+    const uint16x8_t fallingMax = vandq_u16(vcgtq_s16(m, vld1q_s16(above + x + 1)), vcgtq_s16(m, vld1q_s16(below + x - 1)));
+    const uint16x8_t risingMax = vandq_u16(vcgtq_s16(m, vld1q_s16(above + x - 1)), vcgtq_s16(m, vld1q_s16(below + x + 1)));
+    const uint16x8_t diagonalMax = vbslq_u16(oppositeSigns, fallingMax, risingMax);
+
+    uint16x8_t keep = vbslq_u16(horizontal, horizontalMax, vbslq_u16(vertical, verticalMax, diagonalMax));
+    keep = vandq_u16(keep, vcgtq_s16(m, thresholds));
+
+    vst1_u8(edges + x, vmovn_u16(keep));
+  }
+#endif
+
+  // Remaining pixels
+  for (; x < width - 1; ++x) {
+    const int m = magnitude[x];
+    bool keep = false;
+
+    if (m > threshold) {
+      const int ax = std::abs(gx[x]);
+      const int ay = std::abs(gy[x]);
+      const int tan22 = (ax * 13573) >> 15;
+      const int tan67 = tan22 + 2 * ax;
+
+      if (ay < tan22) {
+        keep = m > magnitude[x - 1] && m >= magnitude[x + 1];
+      }
+      else if (ay > tan67) {
+        keep = m > above[x] && m >= below[x];
+      }
+      else {
+        const int s = (gx[x] ^ gy[x]) < 0 ? 1 : -1;
+        keep = m > above[x + s] && m > below[x - s];
+      }
+    }
+
+    edges[x] = keep ? 255 : 0;
+  }
+}
+
+// Sobel L1 magnitude, non-max suppression and one threshold, no hysteresis
+// Magnitude rows are kept in a ring of three so the pass stays in L1 cache
+void detectEdgesSobel(const cv::Mat &source, cv::Mat &edges, int threshold) {
+  const int width = source.cols;
+  const int height = source.rows;
+
+  edges.create(height, width, CV_8UC1);
+
+  if (height == 0 || width == 0) {
+    return;
+  }
+
+  static thread_local std::vector<short> rows;
+  rows.resize((size_t)width * 3 * 3);
+
+  // Ring rows of gx, gy and magnitude
+  short *ring[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      ring[i][j] = rows.data() + (size_t)(i * 3 + j) * width;
+    }
+  }
+
+  sobelRow(source, 0, ring[0][0], ring[0][1], ring[0][2]);
+
+  for (int y = 0; y < height; ++y) {
+    short **above = ring[(y + 2) % 3];
+    short **current = ring[y % 3];
+    short **below = ring[(y + 1) % 3];
+
+    if (y + 1 < height) {
+      sobelRow(source, y + 1, below[0], below[1], below[2]);
+    }
+
+    unsigned char *edgesRow = edges.ptr<unsigned char>(y);
+
+    if (y == 0 || y == height - 1) {
+      memset(edgesRow, 0, width);
+    }
+    else {
+      suppressRow(current[0], current[1], above[2], current[2], below[2], width, threshold, edgesRow);
+    }
+  }
+}
+
+// Threshold lookup table for 8-bit gradients
+void buildGradientLut(unsigned char *lut, int threshold) {
+  for (int i = 0; i < 256; ++i) {
+    lut[i] = i >= threshold ? 255 : 0;
+  }
+}
+
+// Sum of absolute central differences saturated to 8 bits and mapped through lut
+void detectEdgesGradientLut(const cv::Mat &source, cv::Mat &edges, const unsigned char *lut) {
+  const int width = source.cols;
+  const int height = source.rows;
+
+  edges.create(height, width, CV_8UC1);
+
+  static thread_local std::vector<unsigned char> gradients;
+  gradients.resize(width);
+
+  for (int y = 0; y < height; ++y) {
+    unsigned char *edgesRow = edges.ptr<unsigned char>(y);
+
+    if (y == 0 || y == height - 1 || width < 3) {
+      memset(edgesRow, 0, width);
+      continue;
+    }
+
+    const unsigned char *above = source.ptr<unsigned char>(y - 1);
+    const unsigned char *center = source.ptr<unsigned char>(y);
+    const unsigned char *below = source.ptr<unsigned char>(y + 1);
+    unsigned char *gradient = gradients.data();
+
+    gradient[0] = 0;
+    gradient[width - 1] = 0;
+
+    int x = 1;
+
+#if defined(__ARM_NEON)
+    for (; x + 17 <= width; x += 16) {
+      const uint8x16_t dx = vabdq_u8(vld1q_u8(center + x + 1), vld1q_u8(center + x - 1));
+      const uint8x16_t dy = vabdq_u8(vld1q_u8(below + x), vld1q_u8(above + x));
+      vst1q_u8(gradient + x, vqaddq_u8(dx, dy));
+    }
+#endif
+
+    // Remaining pixels
+    for (; x < width - 1; ++x) {
+      gradient[x] = std::min(255, std::abs(center[x + 1] - center[x - 1]) + std::abs(below[x] - above[x]));
+    }
+
+    // Row is in L1 cache, one table load per pixel
+    for (x = 0; x < width; ++x) {
+      edgesRow[x] = lut[gradient[x]];
+    }
+  }
+}
@@ -0,0 +1,286 @@
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Bit weights for packing 16 pixels into 2 bytes (least significant bit first)
+static const uint8_t edgeMaskBitWeights[16] = {
+  1, 2, 4, 8, 16, 32, 64, 128,
+  1, 2, 4, 8, 16, 32, 64, 128
+};
+
+// Edge image packed to 1 bit per pixel
+// Rows are padded to 64 bits so set operations can work on whole words
+class Edge_Mask {
+public:
+  int width = 0;
+  int height = 0;
+  int stride = 0; // Bytes per row
+
+  std::vector<uint64_t> words;
+
+  void create(int width_, int height_) {
+    width = width_;
+    height = height_;
+    stride = (width + 63) / 64 * 8;
+
+    words.assign((size_t)stride / 8 * height, 0);
+  }
+
+  unsigned char* row(int y) {
+    return (unsigned char*)(words.data() + (size_t)y * (stride / 8));
+  }
+
+  const unsigned char* row(int y) const {
+    return (const unsigned char*)(words.data() + (size_t)y * (stride / 8));
+  }
+
+  const unsigned char* data() const {
+    return (const unsigned char*)words.data();
+  }
+
+  size_t dataSize() const {
+    return words.size() * sizeof(uint64_t);
+  }
+
+  bool get(int x, int y) const {
+    return (row(y)[x >> 3] >> (x & 7)) & 1;
+  }
+
+  // Pack 8-bit image, every non-zero pixel is an edge
+  void pack(const cv::Mat &image) {
+    if (image.cols != width || image.rows != height) {
+      create(image.cols, image.rows);
+    }
+
+    for (int y = 0; y < height; ++y) {
+      packRow(image.ptr<unsigned char>(y), row(y));
+    }
+  }
+
+  // Unpack to 8-bit image with edges set to value
+  void unpack(cv::Mat &image, unsigned char value = 255) const {
+    image.create(height, width, CV_8UC1);
+
+    for (int y = 0; y < height; ++y) {
+      unpackRow(row(y), image.ptr<unsigned char>(y), value);
+    }
+  }
+
+  // Combining needs masks of equal dimensions, others are ignored and false is returned
+  bool hasSameSize(const Edge_Mask &other) const {
+    return width == other.width && height == other.height && stride == other.stride;
+  }
+
+  bool orWith(const Edge_Mask &other) {
+    if (!hasSameSize(other)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] |= other.words[i];
+    }
+
+    return true;
+  }
+
+  bool andWith(const Edge_Mask &other) {
+    if (!hasSameSize(other)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] &= other.words[i];
+    }
+
+    return true;
+  }
+
+  bool xorWith(const Edge_Mask &other) {
+    if (!hasSameSize(other)) {
+      return false;
+    }
+
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] ^= other.words[i];
+    }
+
+    return true;
+  }
+
+  // Number of edge pixels
+  size_t count() const {
+    const unsigned char *bytes = data();
+    const size_t size = dataSize();
+    size_t total = 0;
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // Popcount 16 bytes at a time, flush the 16-bit sums before they can overflow
+    while (i + 16 <= size) {
+      uint16x8_t sums = vdupq_n_u16(0);
+
+      for (int block = 0; block < 4000 && i + 16 <= size; ++block, i += 16) {
+        sums = vpadalq_u8(sums, vcntq_u8(vld1q_u8(bytes + i)));
+      }
+
+      uint64x2_t blockTotal = vpaddlq_u32(vpaddlq_u16(sums));
+      total += vgetq_lane_u64(blockTotal, 0) + vgetq_lane_u64(blockTotal, 1);
+    }
+#endif
+
+    for (; i < size; i += 8) {
+      uint64_t word;
+      memcpy(&word, bytes + i, sizeof(word));
+      total += __builtin_popcountll(word);
+    }
+
+    return total;
+  }
+
+  // Edge pixels per pixel
+  float density() const {
+    if (width == 0 || height == 0) {
+      return 0.0f;
+    }
+
+    return (float)count() / ((float)width * height);
+  }
+
+private:
+  void packRow(const unsigned char *src, unsigned char *dst) {
+    int x = 0;
+
+#if defined(__ARM_NEON)
+    const uint8x16_t weights = vld1q_u8(edgeMaskBitWeights);
+
+    for (; x + 16 <= width; x += 16) {
+      uint8x16_t pixels = vld1q_u8(src + x);
+      uint8x16_t bits = vandq_u8(vtstq_u8(pixels, pixels), weights);
+
+      // Sum the weights of each 8 pixel half to a single byte
+      uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+      sum = vpadd_u8(sum, sum);
+      sum = vpadd_u8(sum, sum);
+
+      vst1_lane_u16((uint16_t*)(dst + (x >> 3)), vreinterpret_u16_u8(sum), 0);
+    }
+#endif
+
+    // Remaining pixels
+    memset(dst + (x >> 3), 0, stride - (x >> 3));
+
+    for (; x < width; ++x) {
+      if (src[x]) {
+        dst[x >> 3] |= 1 << (x & 7);
+      }
+    }
+  }
+
+  void unpackRow(const unsigned char *src, unsigned char *dst, unsigned char value) const {
+    int x = 0;
+
+#if defined(__ARM_NEON)
+    const uint8x16_t weights = vld1q_u8(edgeMaskBitWeights);
+    const uint8x16_t values = vdupq_n_u8(value);
+
+    for (; x + 16 <= width; x += 16) {
+      uint8x16_t bits = vcombine_u8(vdup_n_u8(src[x >> 3]), vdup_n_u8(src[(x >> 3) + 1]));
+      vst1q_u8(dst + x, vandq_u8(vtstq_u8(bits, weights), values));
+    }
+#endif
+
+    // Remaining pixels
+    for (; x < width; ++x) {
+      dst[x] = (src[x >> 3] >> (x & 7)) & 1 ? value : 0;
+    }
+  }
+};
+
+// Edge mask with row-wise run-length encoding
+// Every row starts with a run of non-edge pixels and runs alternate after that
+class Edge_Mask_RLE {
+public:
+  int width = 0;
+  int height = 0;
+
+  std::vector<uint32_t> rowOffsets; // Index of first run of each row, height + 1 entries
+  std::vector<uint16_t> runs;
+
+  void encode(const Edge_Mask &mask) {
+    width = mask.width;
+    height = mask.height;
+
+    rowOffsets.resize(height + 1);
+    runs.clear();
+
+    const int wordsPerRow = mask.stride / 8;
+
+    for (int y = 0; y < height; ++y) {
+      rowOffsets[y] = runs.size();
+
+      const uint64_t *rowWords = mask.words.data() + (size_t)y * wordsPerRow;
+      bool value = false;
+      int x = 0;
+
+      while (x < width) {
+        const int next = findBitChange(rowWords, wordsPerRow, x, value);
+        runs.push_back(next - x);
+        x = next;
+        value = !value;
+      }
+    }
+
+    rowOffsets[height] = runs.size();
+  }
+
+  void decode(Edge_Mask &mask) const {
+    mask.create(width, height);
+
+    for (int y = 0; y < height; ++y) {
+      uint64_t *rowWords = (uint64_t*)mask.row(y);
+      bool value = false;
+      int x = 0;
+
+      for (uint32_t i = rowOffsets[y]; i < rowOffsets[y + 1]; ++i) {
+        if (value) {
+          setBits(rowWords, x, x + runs[i]);
+        }
+
+        x += runs[i];
+        value = !value;
+      }
+    }
+  }
+
+  size_t dataSize() const {
+    return rowOffsets.size() * sizeof(uint32_t) + runs.size() * sizeof(uint16_t);
+  }
+
+private:
+  // Find first pixel from x that is not value
+  int findBitChange(const uint64_t *rowWords, int wordCount, int x, bool value) const {
+    int w = x >> 6;
+    uint64_t word = (value ? ~rowWords[w] : rowWords[w]) & (~0ULL << (x & 63));
+
+    while (word == 0) {
+      if (++w >= wordCount) {
+        return width;
+      }
+
+      word = value ? ~rowWords[w] : rowWords[w];
+    }
+
+    return std::min(width, (w << 6) + __builtin_ctzll(word));
+  }
+
+  void setBits(uint64_t *rowWords, int start, int end) const {
+    while (start < end) {
+      const int w = start >> 6;
+      const int bit = start & 63;
+      const int count = std::min(64 - bit, end - start);
+
+      rowWords[w] |= (count == 64 ? ~0ULL : ((1ULL << count) - 1)) << bit;
+      start += count;
+    }
+  }
+};
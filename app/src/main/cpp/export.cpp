@@ -0,0 +1,361 @@
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+struct Export_Stats {
+  int64_t exportedFrames = 0;
+  int64_t exportedBytes = 0;
+  int64_t droppedFrames = 0; // Queue was full
+  int64_t batches = 0;
+  int64_t writeErrors = 0;
+};
+
+// Messages from one detection thread to the export writer
+class Export_Channel {
+public:
+  int streamId;
+
+  Spsc_Queue<std::vector<unsigned char>> messages{64};
+  Spsc_Queue<std::vector<unsigned char>> freeMessages{64}; // Buffers returned by writer
+
+  std::atomic<int64_t> droppedFrames{0};
+
+  Export_Channel(int streamId_) {
+    streamId = streamId_;
+  }
+};
+
+// Drains detector results from all channels to a Unix domain socket or file
+// Detection threads never wait, messages are dropped when a channel is full
+class Exporter {
+public:
+  std::atomic<bool> running{false};
+  bool runLengthEncoding = false; // Export edge masks as RLE instead of packed bits
+
+  int maxBatchMessages = 32;
+  int stopTimeoutMs = 500; // Writer blocked by a consumer that stopped reading is cut off after this
+
+  ~Exporter() {
+    stop();
+  }
+
+  // Path starting with @ is an abstract socket
+  bool start(const std::string &path, bool socket) {
+    stop();
+
+    fd = socket ? connectSocket(path) : open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    isSocket = socket;
+
+    if (fd < 0) {
+      __android_log_print(ANDROID_LOG_ERROR, "edgedetector", "Could not open export %s", path.c_str());
+      return false;
+    }
+
+    running = true;
+    writerDone = false;
+    writerThread = std::thread(&Exporter::writerLoop, this);
+
+    return true;
+  }
+
+  void stop() {
+    if (!running) {
+      return;
+    }
+
+    running = false;
+
+    // Writer finishes its batch, shutting down the socket wakes a blocked send
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stopTimeoutMs);
+    while (!writerDone && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (!writerDone && isSocket) {
+      shutdown(fd, SHUT_RDWR);
+    }
+
+    writerThread.join();
+
+    close(fd);
+    fd = -1;
+  }
+
+  Export_Channel* createChannel(int streamId) {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+
+    Export_Channel *channel = new Export_Channel(streamId);
+    channels.push_back(channel);
+
+    return channel;
+  }
+
+  // Called after the channel's detection thread has stopped, queued messages are dropped
+  void removeChannel(Export_Channel *channel) {
+    {
+      std::lock_guard<std::mutex> lock(channelsMutex);
+
+      channels.erase(std::remove(channels.begin(), channels.end(), channel), channels.end());
+      stats.droppedFrames += channel->droppedFrames + channel->messages.size();
+    }
+
+    // Writer only uses channels while holding the lock
+    delete channel;
+  }
+
+  // Called on detection thread after detect
+  void exportFrame(Export_Channel *channel, Detector &detector, int64_t frameId) {
+    if (!running || channel == nullptr) {
+      return;
+    }
+
+    std::vector<unsigned char> message;
+    channel->freeMessages.pop(message);
+    message.clear();
+
+    Edge_Mask *edgeMask = detector.getEdgeMask();
+
+    if (edgeMask == nullptr) {
+      writeKeypoints(message, detector.keypoints);
+    }
+    else if (runLengthEncoding) {
+      rleMask.encode(*edgeMask);
+      writeMaskRLE(message, rleMask);
+    }
+    else {
+      writeMask(message, *edgeMask);
+    }
+
+    Export_Header &header = *(Export_Header*)message.data();
+    header.streamId = channel->streamId;
+    header.frameId = frameId;
+    header.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    if (!channel->messages.push(std::move(message))) {
+      ++channel->droppedFrames;
+    }
+  }
+
+  Export_Stats getStats() {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+
+    Export_Stats result = stats;
+    for (Export_Channel *channel : channels) {
+      result.droppedFrames += channel->droppedFrames;
+    }
+
+    return result;
+  }
+
+private:
+  int fd = -1;
+  bool isSocket = false;
+  std::thread writerThread;
+  std::atomic<bool> writerDone{true};
+
+  std::mutex channelsMutex;
+  std::vector<Export_Channel*> channels;
+  Export_Stats stats; // Guarded by channels mutex
+
+  static thread_local Edge_Mask_RLE rleMask;
+
+  int connectSocket(const std::string &path) {
+    int socketFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socketFd < 0) {
+      return -1;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    const size_t length = std::min(path.size(), sizeof(address.sun_path) - 1);
+    memcpy(address.sun_path, path.data(), length);
+
+    // Abstract socket name starts with zero byte
+    if (!path.empty() && path[0] == '@') {
+      address.sun_path[0] = 0;
+    }
+
+    if (connect(socketFd, (sockaddr*)&address, offsetof(sockaddr_un, sun_path) + length) < 0) {
+      close(socketFd);
+      return -1;
+    }
+
+    return socketFd;
+  }
+
+  // Append header with payload size, fields set after payload is written
+  void beginMessage(std::vector<unsigned char> &message, Export_Type type, size_t payloadSize) {
+    message.resize(sizeof(Export_Header) + payloadSize);
+
+    Export_Header &header = *(Export_Header*)message.data();
+    header.magic = exportMagic;
+    header.version = exportVersion;
+    header.type = type;
+    header.payloadSize = payloadSize;
+  }
+
+  void writeKeypoints(std::vector<unsigned char> &message, const std::vector<cv::KeyPoint> &keypoints) {
+    const uint32_t count = keypoints.size();
+    beginMessage(message, EXPORT_TYPE_KEYPOINTS, sizeof(uint32_t) + count * 4 * sizeof(float));
+
+    unsigned char *payload = message.data() + sizeof(Export_Header);
+    memcpy(payload, &count, sizeof(count));
+
+    // Structure of arrays
+    float *xs = (float*)(payload + sizeof(uint32_t));
+    float *ys = xs + count;
+    float *sizes = ys + count;
+    float *responses = sizes + count;
+
+    for (uint32_t i = 0; i < count; ++i) {
+      xs[i] = keypoints[i].pt.x;
+      ys[i] = keypoints[i].pt.y;
+      sizes[i] = keypoints[i].size;
+      responses[i] = keypoints[i].response;
+    }
+  }
+
+  void writeMask(std::vector<unsigned char> &message, const Edge_Mask &edgeMask) {
+    const uint32_t dimensions[3] = {(uint32_t)edgeMask.width, (uint32_t)edgeMask.height, (uint32_t)edgeMask.stride};
+    beginMessage(message, EXPORT_TYPE_MASK, sizeof(dimensions) + edgeMask.dataSize());
+
+    unsigned char *payload = message.data() + sizeof(Export_Header);
+    memcpy(payload, dimensions, sizeof(dimensions));
+    memcpy(payload + sizeof(dimensions), edgeMask.data(), edgeMask.dataSize());
+  }
+
+  void writeMaskRLE(std::vector<unsigned char> &message, const Edge_Mask_RLE &mask) {
+    const uint32_t dimensions[3] = {(uint32_t)mask.width, (uint32_t)mask.height, (uint32_t)mask.runs.size()};
+    const size_t offsetsSize = mask.rowOffsets.size() * sizeof(uint32_t);
+    const size_t runsSize = mask.runs.size() * sizeof(uint16_t);
+    beginMessage(message, EXPORT_TYPE_MASK_RLE, sizeof(dimensions) + offsetsSize + runsSize);
+
+    unsigned char *payload = message.data() + sizeof(Export_Header);
+    memcpy(payload, dimensions, sizeof(dimensions));
+    memcpy(payload + sizeof(dimensions), mask.rowOffsets.data(), offsetsSize);
+    memcpy(payload + sizeof(dimensions) + offsetsSize, mask.runs.data(), runsSize);
+  }
+
+  // Write batch with one system call, returns false on error
+  bool writeBatch(std::vector<iovec> &iovecs) {
+    size_t first = 0;
+
+    while (first < iovecs.size()) {
+      ssize_t written;
+
+      if (isSocket) {
+        msghdr header;
+        memset(&header, 0, sizeof(header));
+        header.msg_iov = iovecs.data() + first;
+        header.msg_iovlen = std::min<size_t>(iovecs.size() - first, IOV_MAX);
+        written = sendmsg(fd, &header, MSG_NOSIGNAL);
+      }
+      else {
+        written = writev(fd, iovecs.data() + first, std::min<size_t>(iovecs.size() - first, IOV_MAX));
+      }
+
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return false;
+      }
+
+      // Skip written buffers and continue partially written one
+      while (written > 0) {
+        if ((size_t)written >= iovecs[first].iov_len) {
+          written -= iovecs[first].iov_len;
+          ++first;
+        }
+        else {
+          iovecs[first].iov_base = (unsigned char*)iovecs[first].iov_base + written;
+          iovecs[first].iov_len -= written;
+          written = 0;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  void writerLoop() {
+    std::vector<std::pair<Export_Channel*, std::vector<unsigned char>>> batch;
+    std::vector<iovec> iovecs;
+    bool failed = false;
+
+    while (running) {
+      // Take messages from all channels in turns, lock keeps channels from being removed
+      {
+        std::lock_guard<std::mutex> lock(channelsMutex);
+
+        bool found = true;
+        while (found && (int)batch.size() < maxBatchMessages) {
+          found = false;
+
+          for (Export_Channel *channel : channels) {
+            std::vector<unsigned char> message;
+
+            if (channel->messages.pop(message)) {
+              batch.push_back(std::make_pair(channel, std::move(message)));
+              found = true;
+            }
+          }
+        }
+      }
+
+      if (batch.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+
+      iovecs.clear();
+      size_t batchBytes = 0;
+
+      for (auto &item : batch) {
+        iovecs.push_back({item.second.data(), item.second.size()});
+        batchBytes += item.second.size();
+      }
+
+      // Consumer gone, keep draining so detection is never blocked
+      if (!failed && !writeBatch(iovecs)) {
+        __android_log_print(ANDROID_LOG_ERROR, "edgedetector", "Export write failed: %s", strerror(errno));
+        failed = true;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(channelsMutex);
+
+        if (failed) {
+          ++stats.writeErrors;
+        }
+        else {
+          stats.exportedFrames += batch.size();
+          stats.exportedBytes += batchBytes;
+          ++stats.batches;
+        }
+
+        // Return buffers for reuse to channels that were not removed during write
+        for (auto &item : batch) {
+          if (std::find(channels.begin(), channels.end(), item.first) != channels.end()) {
+            item.first->freeMessages.push(std::move(item.second));
+          }
+        }
+      }
+
+      batch.clear();
+    }
+
+    writerDone = true;
+  }
+};
+
+thread_local Edge_Mask_RLE Exporter::rleMask;
+
+Exporter exporter;
@@ -0,0 +1,33 @@
+// Binary framing of exported detector results, shared by exporter and reader
+// Every message is a fixed header followed by payloadSize bytes, all little endian
+//
+// Keypoints payload: uint32 count, float x[count], float y[count], float size[count], float response[count]
+// Mask payload: uint32 width, uint32 height, uint32 stride, stride * height bytes, least significant bit first
+// RLE mask payload: uint32 width, uint32 height, uint32 runCount, uint32 rowOffsets[height + 1], uint16 runs[runCount]
+//   Rows start with a run of non-edge pixels and runs alternate after that
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+static const uint32_t exportMagic = 0x58474445; // "EDGX"
+static const uint16_t exportVersion = 1;
+
+enum Export_Type {
+  EXPORT_TYPE_KEYPOINTS = 1,
+  EXPORT_TYPE_MASK = 2,
+  EXPORT_TYPE_MASK_RLE = 3
+};
+
+struct Export_Header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t type;
+  uint32_t payloadSize;
+  int32_t streamId; // -1 is the preview
+  uint64_t frameId;
+  uint64_t timestampNs; // Monotonic clock
+};
+
+static_assert(sizeof(Export_Header) == 32, "Export header must be packed to 32 bytes");
@@ -0,0 +1,232 @@
+// Reader for exported detector results, for use in other processes
+// Depends only on the C++ standard library and export_format.cpp
+//
+// Feed received bytes in any chunk sizes and take complete frames with next():
+//
+//   Export_Reader reader;
+//   reader.feed(buffer, received);
+//   Export_Frame frame;
+//   while (reader.next(frame)) {
+//     ...
+//   }
+
+#include <vector>
+#include <string>
+
+#include "export_format.cpp"
+
+struct Export_Frame {
+  Export_Header header;
+
+  // Keypoints
+  std::vector<float> xs;
+  std::vector<float> ys;
+  std::vector<float> sizes;
+  std::vector<float> responses;
+
+  // Edge mask unpacked from bits or runs to 1 byte per pixel
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> mask;
+};
+
+class Export_Reader {
+public:
+  std::string error; // Set when stream is not valid, reader stops
+  uint32_t maxMaskSide = 16384; // Run-length masks that decode wider or higher are not valid
+
+  void feed(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t*)data;
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+
+  // Returns false when no complete frame is buffered
+  bool next(Export_Frame &frame) {
+    if (!error.empty() || buffer.size() - offset < sizeof(Export_Header)) {
+      compact();
+      return false;
+    }
+
+    Export_Header header;
+    memcpy(&header, buffer.data() + offset, sizeof(header));
+
+    if (header.magic != exportMagic || header.version != exportVersion) {
+      error = "Invalid export header";
+      return false;
+    }
+
+    if (buffer.size() - offset < sizeof(Export_Header) + header.payloadSize) {
+      compact();
+      return false;
+    }
+
+    const uint8_t *payload = buffer.data() + offset + sizeof(Export_Header);
+    frame.header = header;
+
+    bool valid = false;
+    switch (header.type) {
+      case EXPORT_TYPE_KEYPOINTS:
+        valid = readKeypoints(frame, payload, header.payloadSize);
+        break;
+      case EXPORT_TYPE_MASK:
+        valid = readMask(frame, payload, header.payloadSize);
+        break;
+      case EXPORT_TYPE_MASK_RLE:
+        valid = readMaskRLE(frame, payload, header.payloadSize);
+        break;
+    }
+
+    if (!valid) {
+      error = "Invalid export payload";
+      return false;
+    }
+
+    offset += sizeof(Export_Header) + header.payloadSize;
+
+    return true;
+  }
+
+private:
+  std::vector<uint8_t> buffer;
+  size_t offset = 0; // Start of first unread frame
+
+  // Drop read frames from buffer
+  void compact() {
+    if (offset > 0) {
+      buffer.erase(buffer.begin(), buffer.begin() + offset);
+      offset = 0;
+    }
+  }
+
+  bool readKeypoints(Export_Frame &frame, const uint8_t *payload, size_t size) {
+    uint32_t count;
+    if (size < sizeof(count)) {
+      return false;
+    }
+
+    memcpy(&count, payload, sizeof(count));
+    if (size != sizeof(count) + (size_t)count * 4 * sizeof(float)) {
+      return false;
+    }
+
+    const uint8_t *arrays = payload + sizeof(count);
+    const size_t arraySize = count * sizeof(float);
+
+    frame.xs.resize(count);
+    frame.ys.resize(count);
+    frame.sizes.resize(count);
+    frame.responses.resize(count);
+
+    memcpy(frame.xs.data(), arrays, arraySize);
+    memcpy(frame.ys.data(), arrays + arraySize, arraySize);
+    memcpy(frame.sizes.data(), arrays + arraySize * 2, arraySize);
+    memcpy(frame.responses.data(), arrays + arraySize * 3, arraySize);
+
+    frame.width = frame.height = 0;
+    frame.mask.clear();
+
+    return true;
+  }
+
+  bool readMask(Export_Frame &frame, const uint8_t *payload, size_t size) {
+    uint32_t dimensions[3];
+    if (size < sizeof(dimensions)) {
+      return false;
+    }
+
+    memcpy(dimensions, payload, sizeof(dimensions));
+    const uint32_t width = dimensions[0];
+    const uint32_t height = dimensions[1];
+    const uint32_t stride = dimensions[2];
+
+    if (stride * 8 < width || size != sizeof(dimensions) + (size_t)stride * height) {
+      return false;
+    }
+
+    const uint8_t *bits = payload + sizeof(dimensions);
+    setMaskSize(frame, width, height);
+
+    for (uint32_t y = 0; y < height; ++y) {
+      const uint8_t *row = bits + (size_t)y * stride;
+      uint8_t *maskRow = frame.mask.data() + (size_t)y * width;
+
+      for (uint32_t x = 0; x < width; ++x) {
+        maskRow[x] = (row[x >> 3] >> (x & 7)) & 1 ? 255 : 0;
+      }
+    }
+
+    return true;
+  }
+
+  bool readMaskRLE(Export_Frame &frame, const uint8_t *payload, size_t size) {
+    uint32_t dimensions[3];
+    if (size < sizeof(dimensions)) {
+      return false;
+    }
+
+    memcpy(dimensions, payload, sizeof(dimensions));
+    const uint32_t width = dimensions[0];
+    const uint32_t height = dimensions[1];
+    const uint32_t runCount = dimensions[2];
+
+    const size_t offsetsSize = ((size_t)height + 1) * sizeof(uint32_t);
+    if (size != sizeof(dimensions) + offsetsSize + (size_t)runCount * sizeof(uint16_t)) {
+      return false;
+    }
+
+    // Runs are few compared to pixels so size is checked before the mask is allocated
+    if (width > maxMaskSide || height > maxMaskSide) {
+      return false;
+    }
+
+    std::vector<uint32_t> rowOffsets((size_t)height + 1);
+    std::vector<uint16_t> runs(runCount);
+    memcpy(rowOffsets.data(), payload + sizeof(dimensions), offsetsSize);
+    if (runCount > 0) {
+      memcpy(runs.data(), payload + sizeof(dimensions) + offsetsSize, runCount * sizeof(uint16_t));
+    }
+
+    // Runs of every row must cover the row exactly
+    for (uint32_t y = 0; y < height; ++y) {
+      if (rowOffsets[y] > rowOffsets[y + 1] || rowOffsets[y + 1] > runCount) {
+        return false;
+      }
+
+      uint64_t rowWidth = 0;
+      for (uint32_t i = rowOffsets[y]; i < rowOffsets[y + 1]; ++i) {
+        rowWidth += runs[i];
+      }
+
+      if (rowWidth != width) {
+        return false;
+      }
+    }
+
+    setMaskSize(frame, width, height);
+
+    for (uint32_t y = 0; y < height; ++y) {
+      uint8_t *maskRow = frame.mask.data() + (size_t)y * width;
+      uint32_t x = 0;
+      bool value = false;
+
+      for (uint32_t i = rowOffsets[y]; i < rowOffsets[y + 1]; ++i) {
+        memset(maskRow + x, value ? 255 : 0, runs[i]);
+        x += runs[i];
+        value = !value;
+      }
+    }
+
+    return true;
+  }
+
+  void setMaskSize(Export_Frame &frame, uint32_t width, uint32_t height) {
+    frame.width = width;
+    frame.height = height;
+    frame.mask.resize((size_t)width * height);
+
+    frame.xs.clear();
+    frame.ys.clear();
+    frame.sizes.clear();
+    frame.responses.clear();
+  }
+};
@@ -0,0 +1,164 @@
+// Luma statistics gathered while the Y plane is copied
+// Histogram, mean and per tile mean and variance cost no extra pass over memory
+class Frame_Stats {
+public:
+  static const int tileSize = 64; // Pixels per tile side
+
+  int width = 0;
+  int height = 0;
+  int tileColumns = 0;
+  int tileRows = 0;
+
+  uint32_t histogram[256];
+  float mean = 0.0f;
+
+  std::vector<float> tileMeans;
+  std::vector<float> tileVariances;
+
+  float exposureChangeThreshold = 12.0f; // Mean luma change between frames
+  bool exposureChanged = false;
+
+  void begin(int width_, int height_) {
+    width = width_;
+    height = height_;
+    tileColumns = (width + tileSize - 1) / tileSize;
+    tileRows = (height + tileSize - 1) / tileSize;
+
+    memset(rowHistograms, 0, sizeof(rowHistograms));
+    tileSums.assign((size_t)tileColumns * tileRows, 0);
+    tileSquareSums.assign((size_t)tileColumns * tileRows, 0);
+  }
+
+  // Copy luma row and add it to statistics
+  void copyRow(unsigned char *dst, const unsigned char *src, int y) {
+    uint64_t *rowTileSums = tileSums.data() + (size_t)(y / tileSize) * tileColumns;
+    uint64_t *rowTileSquareSums = tileSquareSums.data() + (size_t)(y / tileSize) * tileColumns;
+
+    for (int tileX = 0; tileX < tileColumns; ++tileX) {
+      const int start = tileX * tileSize;
+      const int end = std::min(start + tileSize, width);
+      uint64_t sum = 0;
+      uint64_t squareSum = 0;
+      int x = start;
+
+#if defined(__ARM_NEON)
+      uint16x8_t sums = vdupq_n_u16(0);
+      uint32x4_t squareSums = vdupq_n_u32(0);
+
+      // At most 4 iterations per tile so 16-bit sums can not overflow
+      for (; x + 16 <= end; x += 16) {
+        uint8x16_t pixels = vld1q_u8(src + x);
+        vst1q_u8(dst + x, pixels);
+
+        sums = vpadalq_u8(sums, pixels);
+        squareSums = vpadalq_u16(squareSums, vmull_u8(vget_low_u8(pixels), vget_low_u8(pixels)));
+        squareSums = vpadalq_u16(squareSums, vmull_u8(vget_high_u8(pixels), vget_high_u8(pixels)));
+      }
+
+      uint64x2_t sums64 = vpaddlq_u32(vpaddlq_u16(sums));
+      uint64x2_t squareSums64 = vpaddlq_u32(squareSums);
+      sum = vgetq_lane_u64(sums64, 0) + vgetq_lane_u64(sums64, 1);
+      squareSum = vgetq_lane_u64(squareSums64, 0) + vgetq_lane_u64(squareSums64, 1);
+#endif
+
+      // Remaining pixels
+      for (; x < end; ++x) {
+        const unsigned char pixel = src[x];
+        dst[x] = pixel;
+        sum += pixel;
+        squareSum += pixel * pixel;
+      }
+
+      rowTileSums[tileX] += sum;
+      rowTileSquareSums[tileX] += squareSum;
+
+      // Histogram from tile while it is still in L1 cache
+      // Four interleaved histograms avoid stalls on repeated bins
+      x = start;
+      for (; x + 4 <= end; x += 4) {
+        ++rowHistograms[0][dst[x]];
+        ++rowHistograms[1][dst[x + 1]];
+        ++rowHistograms[2][dst[x + 2]];
+        ++rowHistograms[3][dst[x + 3]];
+      }
+
+      for (; x < end; ++x) {
+        ++rowHistograms[0][dst[x]];
+      }
+    }
+  }
+
+  void end() {
+    uint64_t total = 0;
+
+    for (int i = 0; i < 256; ++i) {
+      histogram[i] = rowHistograms[0][i] + rowHistograms[1][i] + rowHistograms[2][i] + rowHistograms[3][i];
+      total += (uint64_t)histogram[i] * i;
+    }
+
+    const float previousMean = mean;
+    mean = width * height > 0 ? (float)((double)total / ((double)width * height)) : 0.0f;
+
+    exposureChanged = frames > 0 && std::fabs(mean - previousMean) > exposureChangeThreshold;
+    ++frames;
+
+    tileMeans.resize(tileSums.size());
+    tileVariances.resize(tileSums.size());
+
+    for (int tileY = 0; tileY < tileRows; ++tileY) {
+      for (int tileX = 0; tileX < tileColumns; ++tileX) {
+        const size_t i = (size_t)tileY * tileColumns + tileX;
+        const double pixels = (double)(std::min((tileX + 1) * tileSize, width) - tileX * tileSize) *
+                              (std::min((tileY + 1) * tileSize, height) - tileY * tileSize);
+        const double tileMean = tileSums[i] / pixels;
+
+        tileMeans[i] = (float)tileMean;
+        tileVariances[i] = (float)std::max(0.0, tileSquareSums[i] / pixels - tileMean * tileMean);
+      }
+    }
+  }
+
+  bool isValid() const {
+    return frames > 0;
+  }
+
+  int median() const {
+    const uint64_t half = ((uint64_t)width * height + 1) / 2;
+    uint64_t count = 0;
+
+    for (int i = 0; i < 256; ++i) {
+      count += histogram[i];
+      if (count >= half) {
+        return i;
+      }
+    }
+
+    return 255;
+  }
+
+  bool isFlatTile(int tileX, int tileY, float varianceThreshold) const {
+    return tileVariances[(size_t)tileY * tileColumns + tileX] < varianceThreshold;
+  }
+
+  // Tile mask with non-flat tiles set, usable as detector region mask
+  cv::Mat getDetailMask(float varianceThreshold) const {
+    cv::Mat mask(tileRows, tileColumns, CV_8UC1);
+
+    for (int tileY = 0; tileY < tileRows; ++tileY) {
+      unsigned char *maskRow = mask.ptr<unsigned char>(tileY);
+
+      for (int tileX = 0; tileX < tileColumns; ++tileX) {
+        maskRow[tileX] = isFlatTile(tileX, tileY, varianceThreshold) ? 0 : 255;
+      }
+    }
+
+    return mask;
+  }
+
+private:
+  int64_t frames = 0;
+
+  uint32_t rowHistograms[4][256];
+  std::vector<uint64_t> tileSums;
+  std::vector<uint64_t> tileSquareSums;
+};
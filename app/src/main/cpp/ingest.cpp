@@ -0,0 +1,68 @@
+// Copy YUV_420_888 planes to NV21 image
+// Gathers luma statistics if frameStats is given and publishes luma stripes if stripePipeline is given
+void ingestImageBuffers(unsigned char *nv21ImageData,
+                        int width,
+                        int height,
+                        const unsigned char *yData,
+                        int ySize,
+                        int yPixelStride,
+                        int yRowStride,
+                        const unsigned char *uData,
+                        int uPixelStride,
+                        int uRowStride,
+                        int vPixelStride,
+                        Frame_Stats *frameStats,
+                        Stripe_Pipeline *stripePipeline) {
+  Profiler_Scope scope(PROFILER_STAGE_INGEST);
+
+  int yIndex = 0;
+  int uvIndex = ySize;
+
+  // Statistics need tightly packed luma
+  const bool computeStats = frameStats != nullptr && yPixelStride == 1;
+
+  if (computeStats) {
+    frameStats->begin(width, height);
+  }
+
+  // Use memcpy to process YUV_420_888 image
+  // Note: this process will only be effective if the source and destination data are both aligned 
+  // and the size is a multiple of 4
+  for (int i = 0; i < height; i++) {
+    int ySrcIndex = i * yRowStride;
+    int uvSrcIndex = i / 2 * uRowStride;
+
+    int ySizeWidth = width * yPixelStride;
+
+    if (computeStats) {
+      // Copy the Y data and gather statistics in the same pass
+      frameStats->copyRow(nv21ImageData + yIndex, yData + ySrcIndex, i);
+    }
+    else {
+      // Use memcpy to copy the Y data
+      memcpy(nv21ImageData + yIndex, yData + ySrcIndex, ySizeWidth);
+    }
+    yIndex += width * yPixelStride;
+
+    if (i % 2 == 0) {
+      // Use memcpy to copy the U and V data
+      memcpy(nv21ImageData + uvIndex, uData + uvSrcIndex, width * uPixelStride / 2);
+      uvIndex += width * uPixelStride / 2;
+      memcpy(nv21ImageData + uvIndex, uData + uvSrcIndex, width * vPixelStride / 2);
+      uvIndex += width * vPixelStride / 2;
+    }
+
+    // Publish every completed stripe
+    if (stripePipeline != nullptr && (i + 1) % stripePipeline->stripeHeight == 0) {
+      stripePipeline->publishRows(i + 1);
+    }
+  }
+
+  if (computeStats) {
+    frameStats->end();
+  }
+
+  if (stripePipeline != nullptr) {
+    stripePipeline->publishRows(height);
+  }
+}
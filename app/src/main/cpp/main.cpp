@@ -2,6 +2,15 @@
 #include <android/log.h>
 #include <GLES3/gl3.h>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <opencv2/core.hpp> // OpenCV core
 #include <opencv2/imgproc.hpp> // OpenCV COLOR_
@@ -12,10 +21,15 @@ using namespace cv;
 int cameraWidth;
 int cameraHeight;
 
+#include "profiler.cpp"
+#include "edge_mask.cpp"
+#include "frame_stats.cpp"
 #include "renderer.cpp"
 #include "renderer_red_squares.cpp"
 #include "renderer_red_lines.cpp"
 #include "renderer_texture.cpp"
+#include "renderer_texture_mask.cpp"
+#include "edge_kernels.cpp"
 #include "detector.cpp"
 #include "detector_edges.cpp"
 #include "detector_edges_image.cpp"
@@ -27,6 +41,16 @@ int cameraHeight;
 #include "detector_edges_image_grayscale.cpp"
 #include "detector_edges_image_background.cpp"
 #include "detector_edges_points.cpp"
+#include "spsc_queue.cpp"
+#include "export_format.cpp"
+#include "export.cpp"
+#include "export_reader.cpp"
+#include "stream.cpp"
+#include "stripe_pipeline.cpp"
+#include "ingest.cpp"
+#include "benchmark.cpp"
+#include "worker_pool.cpp"
+#include "self_test.cpp"
 
 bool initialized;
 
@@ -42,6 +66,7 @@ Detector_Edges_Points *redLinesEdgesDetector;
 Renderer_Red_Squares *redSquaresRenderer;
 Renderer_Red_Lines *redLinesRenderer;
 Renderer_Texture *textureRenderer;
+Renderer_Texture_Mask *textureMaskRenderer;
 
 struct PreviewMode {
   Detector *detector;
@@ -61,6 +86,22 @@ int currentPreviewModeIndex = 0;
 
 bool changeShaderProgramOnNextDraw = false;
 
+Frame_Stats frameStats; // Luma statistics of preview frame
+bool ingestStatsEnabled = false;
+
+Export_Channel *previewExportChannel;
+int64_t previewFrameId = 0;
+
+Stripe_Pipeline stripePipeline; // Detects preview stripes while frame is copied
+bool stripedDetectionEnabled = false;
+
+Worker_Pool workerPool; // Processes additional camera streams
+int nextStreamId = 0;
+
+// Other detection is paused so benchmark has the cores and process wide OpenCV settings to itself
+std::atomic<bool> benchmarkRunning{false};
+std::mutex previewFrameMutex; // Held while a preview frame is processed
+
 void setupDetectors() {
   redEdgesImageDetector = new Detector_Edges_Image_Red();
   greenEdgesImageDetector = new Detector_Edges_Image_Green();
@@ -76,11 +117,12 @@ void setupRenderers() {
   redSquaresRenderer = new Renderer_Red_Squares();
   redLinesRenderer = new Renderer_Red_Lines();
   textureRenderer = new Renderer_Texture();
+  textureMaskRenderer = new Renderer_Texture_Mask();
 }
 
 // Set up detector renderer pairs
 void setupPreviewModes() {
-  previewModes.push_back(new PreviewMode(whiteEdgesImageDetector, textureRenderer));
+  previewModes.push_back(new PreviewMode(whiteEdgesImageDetector, textureMaskRenderer));
   previewModes.push_back(new PreviewMode(redEdgesImageDetector, textureRenderer));
   previewModes.push_back(new PreviewMode(greenEdgesImageDetector, textureRenderer));
   previewModes.push_back(new PreviewMode(blueEdgesImageDetector, textureRenderer));
@@ -117,10 +159,27 @@ void selectNextPreviewMode() {
   selectPreviewModeAtIndex(currentPreviewModeIndex);
 }
 
+// Set regions for all preview mode detectors
+void setPreviewRegions(const std::vector<cv::Rect> &regions, bool cachedBackground) {
+  for (PreviewMode *previewMode : previewModes) {
+    previewMode->detector->cachedRegionBackground = cachedBackground;
+    previewMode->detector->setRegions(regions);
+  }
+}
+
+// Set region mask for all preview mode detectors
+void setPreviewRegionMask(const cv::Mat &mask, bool cachedBackground) {
+  for (PreviewMode *previewMode : previewModes) {
+    previewMode->detector->cachedRegionBackground = cachedBackground;
+    previewMode->detector->setRegionMask(mask);
+  }
+}
+
 void setupGraphics(int width, int height) {
   redSquaresRenderer->setupProgram();  
   redLinesRenderer->setupProgram();  
   textureRenderer->setupProgram(); 
+  textureMaskRenderer->setupProgram();
 
   // Default program
   glUseProgram(currentPreviewMode->renderer->program);
@@ -134,12 +193,54 @@ void detectFrame(unsigned char* nv21ImageData) {
     return; // Prevent crash
   }
 
-  currentPreviewMode->detector->setImageData(nv21ImageData);
+  currentPreviewMode->detector->setImageSize(cameraWidth, cameraHeight);
+  currentPreviewMode->detector->setFrameStats(ingestStatsEnabled ? &frameStats : nullptr);
+
+  {
+    Profiler_Scope scope(PROFILER_STAGE_CONVERT);
+    currentPreviewMode->detector->setImageData(nv21ImageData);
+  }
+
   currentPreviewMode->detector->detect();
-  currentPreviewMode->detector->updateRendererData();
+
+  // Send results to other processes
+  exporter.exportFrame(previewExportChannel, *currentPreviewMode->detector, previewFrameId++);
+
+  {
+    Profiler_Scope scope(PROFILER_STAGE_UPLOAD_PREP);
+    currentPreviewMode->detector->updateRendererData();
+  }
+
   currentPreviewMode->detector->clearImage();
 }
 
+// Start detecting stripes of frame that is being ingested
+// Detector is taken once per frame, preview mode can change while frame is ingested
+void beginStripedFrame(Detector *detector, unsigned char* nv21ImageData) {
+  detector->setImageSize(cameraWidth, cameraHeight);
+  detector->setFrameStats(ingestStatsEnabled ? &frameStats : nullptr);
+  detector->setImageData(nv21ImageData);
+
+  detector->prepareStripes();
+
+  stripePipeline.start();
+  stripePipeline.beginFrame(detector);
+}
+
+void endStripedFrame(Detector *detector) {
+  stripePipeline.endFrame();
+
+  // Send results to other processes
+  exporter.exportFrame(previewExportChannel, *detector, previewFrameId++);
+
+  {
+    Profiler_Scope scope(PROFILER_STAGE_UPLOAD_PREP);
+    detector->updateRendererData();
+  }
+
+  detector->clearImage();
+}
+
 void renderFrame() {
   if (changeShaderProgramOnNextDraw) {
     glUseProgram(currentPreviewMode->renderer->program);
@@ -156,6 +257,23 @@ extern "C" {
   JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_draw(JNIEnv *env, jobject obj);
   JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_processImageBuffers(JNIEnv* env, jobject obj, jobject y, int ySize, int yPixelStride, int yRowStride, jobject u, int uSize, int uPixelStride, int uRowStride, jobject v, int vSize, int vPixelStride, int vRowStride);
   JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_touch(JNIEnv *env, jobject obj);
+  JNIEXPORT jint JNICALL Java_com_app_edgedetector_MyGLSurfaceView_createStream(JNIEnv *env, jobject obj, jint width, jint height, jint mode, jint latencyTargetMs, jint maxQueuedFrames);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_removeStream(JNIEnv *env, jobject obj, jint streamId);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setStreamMode(JNIEnv *env, jobject obj, jint streamId, jint mode);
+  JNIEXPORT jboolean JNICALL Java_com_app_edgedetector_MyGLSurfaceView_processStreamImageBuffer(JNIEnv *env, jobject obj, jint streamId, jobject nv21);
+  JNIEXPORT jlongArray JNICALL Java_com_app_edgedetector_MyGLSurfaceView_getStreamStats(JNIEnv *env, jobject obj, jint streamId);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setRegions(JNIEnv *env, jobject obj, jint streamId, jintArray rects, jboolean cachedBackground);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setRegionMask(JNIEnv *env, jobject obj, jint streamId, jbyteArray mask, jint cols, jint rows, jboolean cachedBackground);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setProfilingEnabled(JNIEnv *env, jobject obj, jboolean enabled);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setIngestStats(JNIEnv *env, jobject obj, jboolean enabled, jboolean autoThresholds, jboolean skipFlatTiles);
+  JNIEXPORT jboolean JNICALL Java_com_app_edgedetector_MyGLSurfaceView_startExport(JNIEnv *env, jobject obj, jstring path, jboolean socket, jboolean runLengthEncoding);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_stopExport(JNIEnv *env, jobject obj);
+  JNIEXPORT jlongArray JNICALL Java_com_app_edgedetector_MyGLSurfaceView_getExportStats(JNIEnv *env, jobject obj);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setStripedDetectionEnabled(JNIEnv *env, jobject obj, jboolean enabled);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_runBenchmark(JNIEnv *env, jobject obj);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setTiledExecution(JNIEnv *env, jobject obj, jboolean enabled);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setQualityTier(JNIEnv *env, jobject obj, jint streamId, jint mode, jint tier);
+  JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_runSelfTest(JNIEnv *env, jobject obj);
 };
 
 JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_init(JNIEnv *env, jobject obj,  jint width, jint height) {
@@ -166,6 +284,8 @@ JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_init(JNIEnv *en
   // Set up list of preview modes
   setupPreviewModes();
 
+  previewExportChannel = exporter.createChannel(-1);
+
   // Select first preview mode
   selectPreviewModeAtIndex(0);
 
@@ -206,6 +326,14 @@ JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_processImageBuf
     return;
   }
 
+  // Benchmark start waits for this frame
+  std::lock_guard<std::mutex> previewFrameLock(previewFrameMutex);
+
+  if (benchmarkRunning) {
+    // Drop frames while benchmark runs
+    return;
+  }
+
   try {
     // Get the address of the underlying memory of the ByteBuffer objects
     unsigned char* yData = (unsigned char*)env->GetDirectBufferAddress(y);
@@ -214,33 +342,30 @@ JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_processImageBuf
 
     unsigned char* nv21ImageData = (unsigned char*)malloc(ySize + uSize + vSize);
 
-    int yIndex = 0;
-    int uvIndex = ySize;
+    // Detect stripes while frame is copied, regions and flat tiles need the whole frame
+    Detector *detector = currentPreviewMode->detector;
+    const bool striped = stripedDetectionEnabled && !changeShaderProgramOnNextDraw &&
+                         !detector->skipFlatTiles && !detector->hasRegions();
 
-    // Use memcpy to process YUV_420_888 image
-    // Note: this process will only be effective if the source and destination data are both aligned 
-    // and the size is a multiple of 4
-    for (int i = 0; i < cameraHeight; i++) {
-      int ySrcIndex = i * yRowStride;
-      int uvSrcIndex = i / 2 * uRowStride;
-
-      int ySizeWidth = cameraWidth * yPixelStride;
+    if (striped) {
+      beginStripedFrame(detector, nv21ImageData);
+    }
 
-      // Use memcpy to copy the Y data
-      memcpy(nv21ImageData + yIndex, yData + ySrcIndex, ySizeWidth);
-      yIndex += cameraWidth * yPixelStride;
+    ingestImageBuffers(nv21ImageData, cameraWidth, cameraHeight,
+                       yData, ySize, yPixelStride, yRowStride,
+                       uData, uPixelStride, uRowStride, vPixelStride,
+                       ingestStatsEnabled ? &frameStats : nullptr,
+                       striped ? &stripePipeline : nullptr);
 
-      if (i % 2 == 0) {
-        // Use memcpy to copy the U and V data
-        memcpy(nv21ImageData + uvIndex, uData + uvSrcIndex, cameraWidth * uPixelStride / 2);
-        uvIndex += cameraWidth * uPixelStride / 2;
-        memcpy(nv21ImageData + uvIndex, uData + uvSrcIndex, cameraWidth * vPixelStride / 2);
-        uvIndex += cameraWidth * vPixelStride / 2;
-      }
+    if (striped) {
+      endStripedFrame(detector);
+    }
+    else {
+      // Detect edges from image
+      detectFrame(nv21ImageData);
     }
 
-    // Detect edges from image
-    detectFrame(nv21ImageData);
+    profiler.endFrame();
 
     // Free NV21 image from memory
     free(nv21ImageData);
@@ -261,3 +386,276 @@ JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_touch(JNIEnv* e
                                                                        jobject obj) {
   selectNextPreviewMode();
 }
+
+JNIEXPORT jint JNICALL Java_com_app_edgedetector_MyGLSurfaceView_createStream(JNIEnv *env,
+                                                                          jobject obj,
+                                                                          jint width,
+                                                                          jint height,
+                                                                          jint mode,
+                                                                          jint latencyTargetMs,
+                                                                          jint maxQueuedFrames) {
+  std::shared_ptr<Stream> stream = std::make_shared<Stream>(nextStreamId++, width, height, mode, latencyTargetMs, maxQueuedFrames);
+
+  if (!stream->isValidMode(mode)) {
+    return -1;
+  }
+
+  // Leave one core for camera and GL threads
+  const int threadCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+  workerPool.start(threadCount);
+
+  workerPool.addStream(stream);
+
+  return stream->id;
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_removeStream(JNIEnv *env,
+                                                                          jobject obj,
+                                                                          jint streamId) {
+  // Calls holding the stream finish before it is deleted
+  workerPool.removeStream(streamId);
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setStreamMode(JNIEnv *env,
+                                                                           jobject obj,
+                                                                           jint streamId,
+                                                                           jint mode) {
+  std::shared_ptr<Stream> stream = workerPool.getStream(streamId);
+
+  if (stream != nullptr) {
+    stream->setMode(mode);
+  }
+}
+
+JNIEXPORT jboolean JNICALL Java_com_app_edgedetector_MyGLSurfaceView_processStreamImageBuffer(JNIEnv *env,
+                                                                                      jobject obj,
+                                                                                      jint streamId,
+                                                                                      jobject nv21) {
+  std::shared_ptr<Stream> stream = workerPool.getStream(streamId);
+
+  if (stream == nullptr || env->GetDirectBufferCapacity(nv21) < (jlong)stream->getFrameSize()) {
+    return false;
+  }
+
+  unsigned char* nv21ImageData = (unsigned char*)env->GetDirectBufferAddress(nv21);
+
+  // Returns false if an older queued frame was dropped
+  return workerPool.submit(stream.get(), nv21ImageData);
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_app_edgedetector_MyGLSurfaceView_getStreamStats(JNIEnv *env,
+                                                                             jobject obj,
+                                                                             jint streamId) {
+  std::shared_ptr<Stream> stream = workerPool.getStream(streamId);
+
+  if (stream == nullptr) {
+    return nullptr;
+  }
+
+  Stream_Stats stats = workerPool.getStats(stream.get());
+
+  // Submitted, processed, dropped, late, average latency us, max latency us, frames per second * 1000, failed
+  const jlong values[8] = {
+    stats.submittedFrames,
+    stats.processedFrames,
+    stats.droppedFrames,
+    stats.lateFrames,
+    (jlong)(stats.averageLatencyMs() * 1000.0),
+    (jlong)(stats.maxLatencyMs * 1000.0),
+    (jlong)(stats.framesPerSecond() * 1000.0),
+    stats.failedFrames
+  };
+
+  jlongArray result = env->NewLongArray(8);
+  env->SetLongArrayRegion(result, 0, 8, values);
+
+  return result;
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setRegions(JNIEnv *env,
+                                                                        jobject obj,
+                                                                        jint streamId,
+                                                                        jintArray rects,
+                                                                        jboolean cachedBackground) {
+  // Rects are x, y, width, height quads, empty array detects whole image
+  std::vector<cv::Rect> regions;
+
+  if (rects != nullptr) {
+    const jint length = env->GetArrayLength(rects);
+    jint *values = env->GetIntArrayElements(rects, nullptr);
+
+    for (jint i = 0; i + 3 < length; i += 4) {
+      regions.push_back(cv::Rect(values[i], values[i + 1], values[i + 2], values[i + 3]));
+    }
+
+    env->ReleaseIntArrayElements(rects, values, JNI_ABORT);
+  }
+
+  // Negative stream id is the preview
+  if (streamId < 0) {
+    setPreviewRegions(regions, cachedBackground);
+    return;
+  }
+
+  std::shared_ptr<Stream> stream = workerPool.getStream(streamId);
+
+  if (stream != nullptr) {
+    stream->setRegions(regions, cachedBackground);
+  }
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setRegionMask(JNIEnv *env,
+                                                                           jobject obj,
+                                                                           jint streamId,
+                                                                           jbyteArray mask,
+                                                                           jint cols,
+                                                                           jint rows,
+                                                                           jboolean cachedBackground) {
+  // Mask is cols x rows cells row by row, non-zero cells are detected, empty mask detects whole image
+  cv::Mat regionMask;
+
+  if (mask != nullptr && cols > 0 && rows > 0 && env->GetArrayLength(mask) >= cols * rows) {
+    regionMask.create(rows, cols, CV_8UC1);
+    env->GetByteArrayRegion(mask, 0, cols * rows, (jbyte*)regionMask.data);
+  }
+
+  // Negative stream id is the preview
+  if (streamId < 0) {
+    setPreviewRegionMask(regionMask, cachedBackground);
+    return;
+  }
+
+  std::shared_ptr<Stream> stream = workerPool.getStream(streamId);
+
+  if (stream != nullptr) {
+    stream->setRegionMask(regionMask, cachedBackground);
+  }
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setProfilingEnabled(JNIEnv *env,
+                                                                                 jobject obj,
+                                                                                 jboolean enabled) {
+  // Per stage report is logged every profiler.reportInterval frames
+  profiler.setEnabled(enabled);
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setIngestStats(JNIEnv *env,
+                                                                            jobject obj,
+                                                                            jboolean enabled,
+                                                                            jboolean autoThresholds,
+                                                                            jboolean skipFlatTiles) {
+  ingestStatsEnabled = enabled;
+
+  // Preview detectors use statistics of the frame they detect
+  for (PreviewMode *previewMode : previewModes) {
+    previewMode->detector->autoThresholds = autoThresholds;
+    previewMode->detector->skipFlatTiles = skipFlatTiles;
+  }
+}
+
+JNIEXPORT jboolean JNICALL Java_com_app_edgedetector_MyGLSurfaceView_startExport(JNIEnv *env,
+                                                                             jobject obj,
+                                                                             jstring path,
+                                                                             jboolean socket,
+                                                                             jboolean runLengthEncoding) {
+  const char *pathChars = env->GetStringUTFChars(path, nullptr);
+  const std::string exportPath(pathChars);
+  env->ReleaseStringUTFChars(path, pathChars);
+
+  exporter.runLengthEncoding = runLengthEncoding;
+
+  return exporter.start(exportPath, socket);
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_stopExport(JNIEnv *env, jobject obj) {
+  exporter.stop();
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_app_edgedetector_MyGLSurfaceView_getExportStats(JNIEnv *env, jobject obj) {
+  Export_Stats stats = exporter.getStats();
+
+  // Exported frames, exported bytes, dropped frames, batches, write errors
+  const jlong values[5] = {
+    stats.exportedFrames,
+    stats.exportedBytes,
+    stats.droppedFrames,
+    stats.batches,
+    stats.writeErrors
+  };
+
+  jlongArray result = env->NewLongArray(5);
+  env->SetLongArrayRegion(result, 0, 5, values);
+
+  return result;
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setStripedDetectionEnabled(JNIEnv *env,
+                                                                                        jobject obj,
+                                                                                        jboolean enabled) {
+  stripedDetectionEnabled = enabled;
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_runBenchmark(JNIEnv *env, jobject obj) {
+  if (benchmarkRunning.exchange(true)) {
+    return;
+  }
+
+  workerPool.pause();
+
+  // Wait for preview frame in progress, later frames see the flag and are dropped
+  {
+    std::lock_guard<std::mutex> lock(previewFrameMutex);
+  }
+
+  // Run in background and log results
+  std::thread([] {
+    profiler.setThreadProfiled(false);
+
+    Benchmark benchmark;
+    benchmark.run();
+
+    workerPool.resume();
+    benchmarkRunning = false;
+  }).detach();
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setTiledExecution(JNIEnv *env,
+                                                                               jobject obj,
+                                                                               jboolean enabled) {
+  for (PreviewMode *previewMode : previewModes) {
+    previewMode->detector->tiledExecution = enabled;
+  }
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_setQualityTier(JNIEnv *env,
+                                                                            jobject obj,
+                                                                            jint streamId,
+                                                                            jint mode,
+                                                                            jint tier) {
+  // Negative stream id is the preview, negative mode sets every mode
+  if (streamId < 0) {
+    for (int i = 0; i < (int)previewModes.size(); ++i) {
+      if (mode < 0 || mode == i) {
+        previewModes[i]->detector->setQualityTier(tier);
+      }
+    }
+
+    return;
+  }
+
+  std::shared_ptr<Stream> stream = workerPool.getStream(streamId);
+
+  if (stream != nullptr) {
+    stream->setQualityTier(mode, tier);
+  }
+}
+
+JNIEXPORT void JNICALL Java_com_app_edgedetector_MyGLSurfaceView_runSelfTest(JNIEnv *env, jobject obj) {
+  // Run in background and log results
+  std::thread([] {
+    profiler.setThreadProfiled(false);
+
+    Self_Test selfTest;
+    selfTest.run();
+  }).detach();
+}
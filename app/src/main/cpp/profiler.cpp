@@ -0,0 +1,333 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+enum Profiler_Stage {
+  PROFILER_STAGE_INGEST,
+  PROFILER_STAGE_CONVERT,
+  PROFILER_STAGE_DETECT,
+  PROFILER_STAGE_COLORIZE,
+  PROFILER_STAGE_UPLOAD_PREP,
+  PROFILER_STAGE_TILED, // Detect, colorize and upload prep of tiled execution as one call
+  PROFILER_STAGE_COUNT
+};
+
+enum Profiler_Counter {
+  PROFILER_COUNTER_CYCLES,
+  PROFILER_COUNTER_INSTRUCTIONS,
+  PROFILER_COUNTER_CACHE_MISSES, // Generic event, L1 data refills on arm64
+  PROFILER_COUNTER_BRANCH_MISSES,
+  PROFILER_COUNTER_LLC_READ_MISSES, // Last level cache reads served from main memory
+  PROFILER_COUNTER_COUNT
+};
+
+static const char* profilerStageNames[PROFILER_STAGE_COUNT] = {
+  "ingest", "convert", "detect", "colorize", "upload-prep", "tiled"
+};
+
+// Counter values with times the group was enabled and counting
+struct Profiler_Sample {
+  uint64_t values[PROFILER_COUNTER_COUNT];
+  uint64_t timeEnabled;
+  uint64_t timeRunning;
+};
+
+// Hardware counters of calling thread, opened as one group so they are read together
+class Profiler_Counters {
+public:
+  ~Profiler_Counters() {
+    for (int i = 0; i < PROFILER_COUNTER_COUNT; ++i) {
+      if (fds[i] >= 0) {
+        close(fds[i]);
+      }
+    }
+  }
+
+  // Returns false if no counters are available
+  bool open() {
+    if (opened) {
+      return groupFd >= 0;
+    }
+
+    opened = true;
+
+    const uint32_t types[PROFILER_COUNTER_COUNT] = {
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE
+    };
+
+    const uint64_t configs[PROFILER_COUNTER_COUNT] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    int groupSize = 0;
+
+    for (int i = 0; i < PROFILER_COUNTER_COUNT; ++i) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[i];
+      attr.config = configs[i];
+      attr.disabled = groupFd < 0 ? 1 : 0;
+      attr.exclude_kernel = 1; // Allowed with stricter perf_event_paranoid
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      // Unsupported counters are skipped
+      fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+
+      if (fds[i] >= 0) {
+        if (groupFd < 0) {
+          groupFd = fds[i];
+        }
+
+        groupIndexes[i] = groupSize++;
+      }
+    }
+
+    if (groupFd < 0) {
+      return false;
+    }
+
+    ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return true;
+  }
+
+  bool isAvailable(int counter) const {
+    return groupIndexes[counter] >= 0;
+  }
+
+  bool read(Profiler_Sample &sample) {
+    // Counter count, time enabled, time running and values
+    uint64_t group[PROFILER_COUNTER_COUNT + 3];
+
+    if (groupFd < 0 || ::read(groupFd, group, sizeof(group)) <= 0) {
+      return false;
+    }
+
+    sample.timeEnabled = group[1];
+    sample.timeRunning = group[2];
+
+    for (int i = 0; i < PROFILER_COUNTER_COUNT; ++i) {
+      sample.values[i] = groupIndexes[i] >= 0 ? group[3 + groupIndexes[i]] : 0;
+    }
+
+    return true;
+  }
+
+  // Counts between samples, scaled up when the group was multiplexed with other events
+  // Returns false if the group was not counting at all
+  static bool getDeltas(const Profiler_Sample &start, const Profiler_Sample &end, uint64_t *deltas, bool &scaled) {
+    const uint64_t enabled = end.timeEnabled - start.timeEnabled;
+    const uint64_t running = end.timeRunning - start.timeRunning;
+
+    if (running == 0) {
+      return false;
+    }
+
+    scaled = running < enabled;
+    const double scale = scaled ? (double)enabled / running : 1.0;
+
+    for (int i = 0; i < PROFILER_COUNTER_COUNT; ++i) {
+      deltas[i] = (uint64_t)((end.values[i] - start.values[i]) * scale);
+    }
+
+    return true;
+  }
+
+private:
+  bool opened = false;
+  int groupFd = -1;
+  int fds[PROFILER_COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+  int groupIndexes[PROFILER_COUNTER_COUNT] = {-1, -1, -1, -1, -1}; // Position in group read
+};
+
+struct Profiler_Stage_Stats {
+  int64_t calls = 0;
+  double totalMs = 0.0;
+  uint64_t counters[PROFILER_COUNTER_COUNT] = {0, 0, 0, 0, 0};
+  int64_t counterCalls[PROFILER_COUNTER_COUNT] = {0, 0, 0, 0, 0}; // Calls with counter available
+  int64_t scaledCalls = 0; // Calls with counters estimated from multiplexed time
+};
+
+// Per pipeline stage wall time and hardware counters aggregated across frames
+// Falls back to wall time only when perf events are not permitted or supported
+class Profiler {
+public:
+  std::atomic<bool> enabled{false};
+  int reportInterval = 300; // Frames between reports
+
+  void setEnabled(bool enabled_) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (enabled_ && !enabled) {
+      reset();
+    }
+
+    enabled = enabled_;
+  }
+
+  // Only the preview is profiled, stream workers and benchmarks turn it off for their threads
+  void setThreadProfiled(bool profiled) {
+    threadProfiled() = profiled;
+  }
+
+  bool isThreadProfiled() {
+    return threadProfiled();
+  }
+
+  Profiler_Counters& getThreadCounters() {
+    static thread_local Profiler_Counters threadCounters;
+    return threadCounters;
+  }
+
+  void addStage(Profiler_Stage stage, double ms, const uint64_t *counterDeltas, bool scaled, const Profiler_Counters &counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Profiler_Stage_Stats &stats = stageStats[stage];
+    ++stats.calls;
+    stats.totalMs += ms;
+
+    if (counterDeltas == nullptr) {
+      return;
+    }
+
+    for (int i = 0; i < PROFILER_COUNTER_COUNT; ++i) {
+      if (counters.isAvailable(i)) {
+        stats.counters[i] += counterDeltas[i];
+        ++stats.counterCalls[i];
+      }
+    }
+
+    if (scaled) {
+      ++stats.scaledCalls;
+    }
+  }
+
+  void endFrame() {
+    if (!enabled) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (++frames >= reportInterval) {
+      logReport();
+      reset();
+    }
+  }
+
+  // Must be called with mutex locked
+  void logReport() {
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Profile of %lld preview frames", (long long)frames);
+
+    for (int stage = 0; stage < PROFILER_STAGE_COUNT; ++stage) {
+      const Profiler_Stage_Stats &stats = stageStats[stage];
+
+      if (stats.calls == 0) {
+        continue;
+      }
+
+      char counterText[256] = "counters n/a";
+
+      if (stats.counterCalls[PROFILER_COUNTER_CYCLES] > 0) {
+        const double cycles = (double)stats.counters[PROFILER_COUNTER_CYCLES];
+        const double instructions = (double)stats.counters[PROFILER_COUNTER_INSTRUCTIONS];
+
+        snprintf(counterText, sizeof(counterText), "cycles %.0f, IPC %.2f, cache misses %.0f, branch misses %.0f",
+                 cycles / frames,
+                 stats.counterCalls[PROFILER_COUNTER_INSTRUCTIONS] > 0 && cycles > 0.0 ? instructions / cycles : 0.0,
+                 (double)stats.counters[PROFILER_COUNTER_CACHE_MISSES] / frames,
+                 (double)stats.counters[PROFILER_COUNTER_BRANCH_MISSES] / frames);
+
+        if (stats.counterCalls[PROFILER_COUNTER_LLC_READ_MISSES] > 0) {
+          const size_t length = strlen(counterText);
+          snprintf(counterText + length, sizeof(counterText) - length, ", LLC read misses %.0f",
+                   (double)stats.counters[PROFILER_COUNTER_LLC_READ_MISSES] / frames);
+        }
+
+        // Estimates are less reliable for short stages
+        if (stats.scaledCalls > 0) {
+          const size_t length = strlen(counterText);
+          snprintf(counterText + length, sizeof(counterText) - length, ", multiplexed in %.0f%% of calls",
+                   100.0 * stats.scaledCalls / stats.counterCalls[PROFILER_COUNTER_CYCLES]);
+        }
+      }
+
+      __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  %-11s %7.3f ms/frame, %s",
+                          profilerStageNames[stage], stats.totalMs / frames, counterText);
+    }
+  }
+
+private:
+  std::mutex mutex;
+  int64_t frames = 0;
+
+  static bool& threadProfiled() {
+    static thread_local bool profiled = true;
+    return profiled;
+  }
+
+  Profiler_Stage_Stats stageStats[PROFILER_STAGE_COUNT];
+
+  void reset() {
+    frames = 0;
+
+    for (int stage = 0; stage < PROFILER_STAGE_COUNT; ++stage) {
+      stageStats[stage] = Profiler_Stage_Stats();
+    }
+  }
+};
+
+Profiler profiler;
+
+// Profiles a stage until end of scope
+class Profiler_Scope {
+public:
+  Profiler_Scope(Profiler_Stage stage_, bool profiled = true) {
+    active = profiled && profiler.enabled && profiler.isThreadProfiled();
+
+    if (!active) {
+      return;
+    }
+
+    stage = stage_;
+    counters = &profiler.getThreadCounters();
+    hasCounters = counters->open() && counters->read(startSample);
+    startTime = std::chrono::steady_clock::now();
+  }
+
+  ~Profiler_Scope() {
+    if (!active) {
+      return;
+    }
+
+    const auto endTime = std::chrono::steady_clock::now();
+    Profiler_Sample endSample;
+    uint64_t counterDeltas[PROFILER_COUNTER_COUNT];
+    bool scaled = false;
+
+    hasCounters = hasCounters && counters->read(endSample) && Profiler_Counters::getDeltas(startSample, endSample, counterDeltas, scaled);
+
+    const double ms = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    profiler.addStage(stage, ms, hasCounters ? counterDeltas : nullptr, scaled, *counters);
+  }
+
+private:
+  bool active;
+  bool hasCounters;
+  Profiler_Stage stage;
+  Profiler_Counters *counters;
+  Profiler_Sample startSample;
+  std::chrono::steady_clock::time_point startTime;
+};
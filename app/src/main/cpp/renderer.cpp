@@ -76,6 +76,8 @@ public:
   virtual void draw() {}
   virtual void setImageData(unsigned char* imageData_) {}
   virtual void setKeypoints(std::vector<cv::KeyPoint> &keypoints_) {}
+  virtual void setEdgeMask(Edge_Mask *edgeMask_) {}
+  virtual void setImageRegions(const std::vector<cv::Rect> &regions_, int64_t fullImageVersion_) {}
   virtual void clear() {}
 
 protected:
@@ -65,7 +65,37 @@ public:
     glVertexAttribPointer(positionHandle, 2, GL_FLOAT, GL_FALSE, verticesSize, vertices);
     glEnableVertexAttribArray(positionHandle);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, cameraWidth, cameraHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Regions are set on camera thread
+    int64_t drawImageVersion;
+    {
+      std::lock_guard<std::mutex> lock(regionsMutex);
+      drawRegions = regions;
+      drawImageVersion = fullImageVersion;
+    }
+
+    if (drawRegions.empty() || drawImageVersion != uploadedImageVersion || cameraWidth != uploadedWidth || cameraHeight != uploadedHeight) {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, cameraWidth, cameraHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
+
+      uploadedImageVersion = drawImageVersion;
+      uploadedWidth = cameraWidth;
+      uploadedHeight = cameraHeight;
+    }
+    else {
+      // Only regions changed, keep background in texture
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, cameraWidth);
+
+      for (const cv::Rect &region : drawRegions) {
+        const unsigned char *regionData = imageData + ((size_t)region.y * cameraWidth + region.x) * 3;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, GL_RGB, GL_UNSIGNED_BYTE, regionData);
+      }
+
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
 
     glDisableVertexAttribArray(positionHandle);
@@ -75,6 +105,26 @@ public:
     imageData = imageData_;
   }
 
+  void setImageRegions(const std::vector<cv::Rect> &regions_, int64_t fullImageVersion_) override {
+    const cv::Rect imageRect(0, 0, cameraWidth, cameraHeight);
+
+    std::lock_guard<std::mutex> lock(regionsMutex);
+
+    regions.clear();
+    for (const cv::Rect &region : regions_) {
+      if (!(region & imageRect).empty()) {
+        regions.push_back(region & imageRect);
+      }
+    }
+
+    fullImageVersion = fullImageVersion_;
+  }
+
+  void clear() override {
+    // Upload whole image after preview mode change
+    uploadedImageVersion = -1;
+  }
+
 private:
   GLuint positionHandle;
   GLint texCoordHandle;
@@ -98,4 +148,12 @@ private:
   const size_t iboSize = 6 * sizeof(GLushort);
 
   unsigned char* imageData;
+
+  std::mutex regionsMutex;
+  std::vector<cv::Rect> regions; // Changed parts of image data, guarded by regions mutex
+  int64_t fullImageVersion = 0; // Guarded by regions mutex
+  std::vector<cv::Rect> drawRegions; // Copy of regions used by draw
+  int64_t uploadedImageVersion = -1;
+  int uploadedWidth = 0;
+  int uploadedHeight = 0;
 };
@@ -0,0 +1,115 @@
+class Renderer_Texture_Mask : public Renderer {
+public:
+  const char* getVertexShader() override {
+    return R"(#version 300 es
+      layout(location = 0) in vec2 vPosition;
+      layout(location = 1) in vec2 vTexCoord;
+      out highp vec2 texCoord;
+
+      void main() {
+        gl_Position = vec4(vPosition, 0.0, 1.0);
+        texCoord = vTexCoord;
+      }
+    )";
+  }
+
+  // Unpack 1 bit per pixel mask, least significant bit is the leftmost pixel
+  const char* getFragmentShader() override {
+    return R"(#version 300 es
+      precision mediump float;
+      in highp vec2 texCoord;
+      uniform highp usampler2D uMask;
+      uniform highp ivec2 uMaskSize;
+      out vec4 fragColor;
+
+      void main() {
+        highp ivec2 pixel = min(ivec2(texCoord * vec2(uMaskSize)), uMaskSize - 1);
+        uint bits = texelFetch(uMask, ivec2(pixel.x >> 3, pixel.y), 0).r;
+        float edge = float((bits >> uint(pixel.x & 7)) & 1u);
+        fragColor = vec4(edge, edge, edge, 1.0);
+      }
+    )";
+  }
+
+  void setupProgram() override {
+    program = createProgram(getVertexShader(), getFragmentShader());
+    if (!program) {
+      return;
+    }
+
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+
+    positionHandle = glGetAttribLocation(program, "vPosition");
+    texCoordHandle = glGetAttribLocation(program, "vTexCoord");
+    maskHandle = glGetUniformLocation(program, "uMask");
+    maskSizeHandle = glGetUniformLocation(program, "uMaskSize");
+
+    glActiveTexture(GL_TEXTURE0);
+
+    // Integer textures can not be filtered
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+
+  void draw() override {
+    if (edgeMask == nullptr || edgeMask->words.empty()) {
+      return;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, iboSize, indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(positionHandle, 2, GL_FLOAT, GL_FALSE, verticesSize, vertices);
+    glEnableVertexAttribArray(positionHandle);
+    glVertexAttribPointer(texCoordHandle, 2, GL_FLOAT, GL_FALSE, verticesSize, vertices + 2);
+    glEnableVertexAttribArray(texCoordHandle);
+
+    glUniform1i(maskHandle, 0);
+    glUniform2i(maskSizeHandle, edgeMask->width, edgeMask->height);
+
+    // Upload packed rows, one byte holds 8 pixels
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, edgeMask->stride, edgeMask->height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, edgeMask->data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+
+    glDisableVertexAttribArray(positionHandle);
+  }
+
+  void setEdgeMask(Edge_Mask *edgeMask_) override {
+    edgeMask = edgeMask_;
+  }
+
+private:
+  GLuint positionHandle;
+  GLint texCoordHandle;
+  GLint maskHandle;
+  GLint maskSizeHandle;
+  GLuint texture;
+
+  // Square
+  const GLfloat vertices[16] = {
+     1.0f,  1.0f, 0.0f, 0.0f, // top right
+     1.0f, -1.0f, 1.0f, 0.0f, // bottom right
+    -1.0f, -1.0f, 1.0f, 1.0f, // bottom left
+    -1.0f,  1.0f, 0.0f, 1.0f  // top left
+  };
+
+  const GLushort indices[6] = {
+    0, 1, 2,
+    2, 3, 0
+  };
+
+  const size_t verticesSize = 4 * sizeof(GLfloat);
+  const size_t iboSize = 6 * sizeof(GLushort);
+
+  Edge_Mask *edgeMask = nullptr;
+};
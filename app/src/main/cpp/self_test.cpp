@@ -0,0 +1,397 @@
+// Native self tests, results are logged
+class Self_Test {
+public:
+  int timeoutMs = 10000; // Longest wait for queued frames
+
+  bool run() {
+    bool passed = true;
+
+    passed = runEdgeMask() && passed;
+    passed = runStreams() && passed;
+    passed = runExport() && passed;
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Self test %s", passed ? "passed" : "failed");
+
+    return passed;
+  }
+
+  // Packed masks against 8-bit reference images, widths cover partial NEON blocks and words
+  bool runEdgeMask() {
+    const int widths[] = {1, 15, 16, 17, 63, 64, 65, 130, 333};
+    const int height = 7;
+
+    std::mt19937 random(7);
+    bool passed = true;
+
+    for (int width : widths) {
+      // Reference images with edges of different values and a mask of other size
+      cv::Mat a(height, width, CV_8UC1);
+      cv::Mat b(height, width, CV_8UC1);
+
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          a.at<unsigned char>(y, x) = random() % 3 == 0 ? 1 + random() % 255 : 0;
+          b.at<unsigned char>(y, x) = random() % 2 == 0 ? 255 : 0;
+        }
+      }
+
+      Edge_Mask maskA;
+      Edge_Mask maskB;
+      maskA.pack(a);
+      maskB.pack(b);
+
+      passed = checkMask(maskA, a, [](bool p, bool) { return p; }, b, width, "pack") && passed;
+
+      Edge_Mask_RLE rle;
+      Edge_Mask decoded;
+      rle.encode(maskA);
+      rle.decode(decoded);
+      passed = checkMask(decoded, a, [](bool p, bool) { return p; }, b, width, "rle") && passed;
+
+      Edge_Mask combined = maskA;
+      passed = check(combined.orWith(maskB), "width %d or skipped", width) && passed;
+      passed = checkMask(combined, a, [](bool p, bool q) { return p || q; }, b, width, "or") && passed;
+
+      combined = maskA;
+      passed = check(combined.andWith(maskB), "width %d and skipped", width) && passed;
+      passed = checkMask(combined, a, [](bool p, bool q) { return p && q; }, b, width, "and") && passed;
+
+      combined = maskA;
+      passed = check(combined.xorWith(maskB), "width %d xor skipped", width) && passed;
+      passed = checkMask(combined, a, [](bool p, bool q) { return p != q; }, b, width, "xor") && passed;
+
+      Edge_Mask other;
+      other.create(width + 1, height);
+      passed = check(!combined.orWith(other) && !combined.andWith(other) && !combined.xorWith(other),
+                     "width %d combined with mask of other size", width) && passed;
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Edge mask self test %s", passed ? "passed" : "failed");
+
+    return passed;
+  }
+
+  // Synthetic streams of different sizes, modes and latency targets on one worker pool
+  bool runStreams() {
+    struct Stream_Config {
+      int width;
+      int height;
+      int mode;
+      int latencyTargetMs;
+      int maxQueuedFrames;
+      int frameIntervalMs;
+    };
+
+    // Grayscale and background modes need color input and fail on the luma plane
+    const std::vector<Stream_Config> configs = {
+      {320, 240, 0, 33, 2, 5},
+      {640, 480, 1, 66, 3, 8},
+      {160, 120, 6, 16, 1, 2},
+      {480, 360, 3, 100, 4, 10}
+    };
+
+    const int extraFrames = 3; // Submitted past full queue before workers start
+    const int concurrentFrames = 60;
+
+    Worker_Pool pool;
+    std::vector<std::shared_ptr<Stream>> streams;
+    std::vector<std::vector<unsigned char>> frames;
+    bool passed = true;
+
+    // Frames with an edge mask or keypoints, counted on worker threads
+    std::mutex outputMutex;
+    std::vector<int64_t> outputFrames(configs.size(), 0);
+
+    for (size_t i = 0; i < configs.size(); ++i) {
+      const Stream_Config &config = configs[i];
+
+      streams.push_back(std::make_shared<Stream>(i, config.width, config.height, config.mode, config.latencyTargetMs, config.maxQueuedFrames));
+      pool.addStream(streams.back());
+
+      streams.back()->onFrameDetected = [&outputMutex, &outputFrames, i](Stream &stream, Detector &detector, int64_t frameId) {
+        Edge_Mask *mask = detector.getEdgeMask();
+        const bool output = (mask != nullptr && mask->width == stream.width && mask->height == stream.height && mask->count() > 0) ||
+                            !detector.keypoints.empty();
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        outputFrames[i] += output;
+      };
+
+      // Shapes with strong edges
+      Benchmark_Frame frame;
+      frame.create(config.width, config.height);
+
+      frames.push_back(std::vector<unsigned char>(frame.getNV21Size()));
+      frame.ingest(frames.back().data(), nullptr);
+    }
+
+    // Invalid mode is reported and not used
+    {
+      Stream invalidStream(configs.size(), 16, 16, 8, 33, 1);
+      passed = check(!invalidStream.isValidMode(8) && invalidStream.modeIndex == 0, "invalid mode 8 accepted") && passed;
+    }
+
+    // Without workers queues fill up and the oldest frames are dropped
+    for (size_t i = 0; i < configs.size(); ++i) {
+      for (int frame = 0; frame < configs[i].maxQueuedFrames + extraFrames; ++frame) {
+        const bool accepted = pool.submit(streams[i].get(), frames[i].data());
+        passed = check(accepted == (frame < configs[i].maxQueuedFrames), "stream %zu frame %d accepted %d", i, frame, accepted) && passed;
+      }
+    }
+
+    pool.start(2);
+    passed = waitForQueues(pool, streams) && passed;
+
+    for (size_t i = 0; i < configs.size(); ++i) {
+      const Stream_Stats stats = pool.getStats(streams[i].get());
+      const int submitted = configs[i].maxQueuedFrames + extraFrames;
+
+      passed = check(stats.droppedFrames == extraFrames, "stream %zu dropped %lld", i, (long long)stats.droppedFrames) && passed;
+      passed = check(stats.processedFrames == configs[i].maxQueuedFrames, "stream %zu processed %lld", i, (long long)stats.processedFrames) && passed;
+      passed = check(stats.lastFrameId == submitted - 1, "stream %zu newest frame %lld not processed", i, (long long)stats.lastFrameId) && passed;
+    }
+
+    // All streams submit at their own rate at the same time
+    std::vector<std::thread> producers;
+
+    for (size_t i = 0; i < configs.size(); ++i) {
+      producers.push_back(std::thread([&, i] {
+        for (int frame = 0; frame < concurrentFrames; ++frame) {
+          pool.submit(streams[i].get(), frames[i].data());
+          std::this_thread::sleep_for(std::chrono::milliseconds(configs[i].frameIntervalMs));
+        }
+      }));
+    }
+
+    for (std::thread &producer : producers) {
+      producer.join();
+    }
+
+    passed = waitForQueues(pool, streams) && passed;
+
+    for (size_t i = 0; i < configs.size(); ++i) {
+      const Stream_Stats stats = pool.getStats(streams[i].get());
+      const int submitted = configs[i].maxQueuedFrames + extraFrames + concurrentFrames;
+
+      passed = check(stats.submittedFrames == submitted, "stream %zu submitted %lld", i, (long long)stats.submittedFrames) && passed;
+      passed = check(stats.processedFrames + stats.droppedFrames == submitted, "stream %zu processed %lld + dropped %lld", i,
+                     (long long)stats.processedFrames, (long long)stats.droppedFrames) && passed;
+      passed = check(stats.outOfOrderFrames == 0, "stream %zu out of order %lld", i, (long long)stats.outOfOrderFrames) && passed;
+      passed = check(stats.lastFrameId == submitted - 1, "stream %zu newest frame %lld not processed", i, (long long)stats.lastFrameId) && passed;
+      passed = check(stats.failedFrames == 0, "stream %zu failed %lld", i, (long long)stats.failedFrames) && passed;
+
+      {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        passed = check(outputFrames[i] == stats.processedFrames, "stream %zu output in %lld of %lld frames", i,
+                       (long long)outputFrames[i], (long long)stats.processedFrames) && passed;
+      }
+
+      __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  stream %zu %dx%d: processed %lld, dropped %lld, late %lld, average latency %.2f ms",
+                          i, configs[i].width, configs[i].height, (long long)stats.processedFrames, (long long)stats.droppedFrames,
+                          (long long)stats.lateFrames, stats.averageLatencyMs());
+    }
+
+    // Removed stream refuses frames
+    pool.removeStream(0);
+    passed = check(!pool.submit(streams[0].get(), frames[0].data()), "removed stream accepted frame") && passed;
+
+    pool.stop();
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Streams self test %s", passed ? "passed" : "failed");
+
+    return passed;
+  }
+
+  // Exporter with a slow local consumer, detection must not wait for it
+  bool runExport() {
+    const int frames = 2000;
+    const int keypointCount = 1000; // About 16 KB per message
+    const double maxExportMs = 5.0; // Longest allowed exportFrame call
+
+    char path[64];
+    snprintf(path, sizeof(path), "@edgedetector-self-test-%d", (int)getpid());
+
+    const int listenFd = listenSocket(path);
+    if (listenFd < 0) {
+      return check(false, "could not listen on %s", path);
+    }
+
+    // Consumer reads in small pieces with pauses and parses frames
+    std::vector<uint64_t> receivedFrameIds;
+    std::string readerError;
+
+    std::thread consumer([&] {
+      const int fd = accept(listenFd, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+
+      const int receiveBufferSize = 16 * 1024;
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+
+      Export_Reader reader;
+      Export_Frame frame;
+      unsigned char buffer[8192];
+      ssize_t received;
+
+      while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        reader.feed(buffer, received);
+
+        while (reader.next(frame)) {
+          receivedFrameIds.push_back(frame.header.frameId);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+
+      readerError = reader.error;
+      close(fd);
+    });
+
+    Exporter testExporter;
+    bool passed = check(testExporter.start(path, true), "could not connect to %s", path);
+
+    Export_Channel *channel = testExporter.createChannel(0);
+
+    Detector detector;
+    detector.keypoints.resize(keypointCount, cv::KeyPoint(1.0f, 2.0f, 3.0f));
+
+    double maxMs = 0.0;
+    const auto exportStart = std::chrono::steady_clock::now();
+
+    for (int frame = 0; passed && frame < frames; ++frame) {
+      const auto start = std::chrono::steady_clock::now();
+      testExporter.exportFrame(channel, detector, frame);
+      maxMs = std::max(maxMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    const int64_t droppedFrames = channel->droppedFrames;
+
+    // Let writer drain queue before closing socket
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (channel->messages.size() > 0 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    // Delivered rate is bound by the slow consumer, not by the writer
+    const double exportSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - exportStart).count();
+
+    testExporter.stop();
+    shutdown(listenFd, SHUT_RDWR);
+    consumer.join();
+    close(listenFd);
+
+    const Export_Stats stats = testExporter.getStats();
+    testExporter.removeChannel(channel);
+
+    passed = check(maxMs < maxExportMs, "exportFrame took %.2f ms", maxMs) && passed;
+    passed = check(droppedFrames > 0, "no frames dropped behind slow consumer") && passed;
+    passed = check(stats.writeErrors == 0, "%lld write errors", (long long)stats.writeErrors) && passed;
+    passed = check(readerError.empty(), "reader error: %s", readerError.c_str()) && passed;
+    passed = check((int64_t)receivedFrameIds.size() == stats.exportedFrames, "received %zu of %lld exported frames",
+                   receivedFrameIds.size(), (long long)stats.exportedFrames) && passed;
+    passed = check(stats.exportedFrames + droppedFrames == frames, "exported %lld + dropped %lld", (long long)stats.exportedFrames, (long long)droppedFrames) && passed;
+
+    for (size_t i = 1; i < receivedFrameIds.size(); ++i) {
+      if (receivedFrameIds[i] <= receivedFrameIds[i - 1]) {
+        passed = check(false, "frame %llu received after %llu", (unsigned long long)receivedFrameIds[i], (unsigned long long)receivedFrameIds[i - 1]);
+        break;
+      }
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "Export self test %s: exported %lld, dropped %lld, longest exportFrame %.3f ms",
+                        passed ? "passed" : "failed", (long long)stats.exportedFrames, (long long)droppedFrames, maxMs);
+    __android_log_print(ANDROID_LOG_INFO, "edgedetector", "  delivered %.0f frames/s, %.2f MB/s",
+                        stats.exportedFrames / exportSeconds, stats.exportedBytes / exportSeconds / (1024.0 * 1024.0));
+
+    return passed;
+  }
+
+protected:
+  // Listening Unix domain socket, path starting with @ is an abstract socket
+  int listenSocket(const std::string &path) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return -1;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    const size_t length = std::min(path.size(), sizeof(address.sun_path) - 1);
+    memcpy(address.sun_path, path.data(), length);
+
+    if (path[0] == '@') {
+      address.sun_path[0] = 0;
+    }
+
+    if (bind(fd, (sockaddr*)&address, offsetof(sockaddr_un, sun_path) + length) < 0 || listen(fd, 1) < 0) {
+      close(fd);
+      return -1;
+    }
+
+    return fd;
+  }
+
+  bool check(bool condition, const char *format, ...) {
+    if (!condition) {
+      char message[256];
+
+      va_list arguments;
+      va_start(arguments, format);
+      vsnprintf(message, sizeof(message), format, arguments);
+      va_end(arguments);
+
+      __android_log_print(ANDROID_LOG_ERROR, "edgedetector", "  Check failed: %s", message);
+    }
+
+    return condition;
+  }
+
+  // Unpacked mask and its popcount must match op of the reference images
+  bool checkMask(const Edge_Mask &mask, const cv::Mat &a, const std::function<bool(bool, bool)> &op, const cv::Mat &b,
+                 int width, const char *name) {
+    cv::Mat unpacked;
+    mask.unpack(unpacked, 200);
+
+    size_t expectedCount = 0;
+
+    for (int y = 0; y < a.rows; ++y) {
+      for (int x = 0; x < a.cols; ++x) {
+        const bool expected = op(a.at<unsigned char>(y, x) != 0, b.at<unsigned char>(y, x) != 0);
+        expectedCount += expected;
+
+        if (unpacked.at<unsigned char>(y, x) != (expected ? 200 : 0)) {
+          return check(false, "width %d %s differs at %d, %d", width, name, x, y);
+        }
+      }
+    }
+
+    return check(mask.count() == expectedCount, "width %d %s count %zu, expected %zu", width, name, mask.count(), expectedCount);
+  }
+
+  // Wait until every submitted frame is processed, failed or dropped
+  bool waitForQueues(Worker_Pool &pool, const std::vector<std::shared_ptr<Stream>> &streams) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (std::chrono::steady_clock::now() < deadline) {
+      bool done = true;
+
+      for (const std::shared_ptr<Stream> &stream : streams) {
+        const Stream_Stats stats = pool.getStats(stream.get());
+        done = done && stats.processedFrames + stats.failedFrames + stats.droppedFrames == stats.submittedFrames;
+      }
+
+      if (done) {
+        return true;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    return check(false, "queued frames not processed in %d ms", timeoutMs);
+  }
+};
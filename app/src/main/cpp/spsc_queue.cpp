@@ -0,0 +1,54 @@
+// Lock-free queue for one producer thread and one consumer thread
+template<typename T>
+class Spsc_Queue {
+public:
+  explicit Spsc_Queue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    mask = size - 1;
+    items.resize(size);
+  }
+
+  // Returns false if queue is full, called only from producer thread
+  bool push(T &&item) {
+    const size_t head = headIndex.load(std::memory_order_relaxed);
+
+    if (head - tailIndex.load(std::memory_order_acquire) > mask) {
+      return false;
+    }
+
+    items[head & mask] = std::move(item);
+    headIndex.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Returns false if queue is empty, called only from consumer thread
+  bool pop(T &item) {
+    const size_t tail = tailIndex.load(std::memory_order_relaxed);
+
+    if (tail == headIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    item = std::move(items[tail & mask]);
+    tailIndex.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  size_t size() const {
+    return headIndex.load(std::memory_order_acquire) - tailIndex.load(std::memory_order_acquire);
+  }
+
+private:
+  size_t mask;
+  std::vector<T> items;
+
+  // Separate cache lines so producer and consumer do not share one
+  alignas(64) std::atomic<size_t> headIndex{0};
+  alignas(64) std::atomic<size_t> tailIndex{0};
+};
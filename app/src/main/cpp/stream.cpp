@@ -0,0 +1,158 @@
+// NV21 frame waiting to be processed by a stream
+struct Stream_Frame {
+  int64_t frameId;
+  std::chrono::steady_clock::time_point submitTime;
+  std::vector<unsigned char> nv21ImageData;
+};
+
+struct Stream_Stats {
+  int64_t submittedFrames = 0;
+  int64_t processedFrames = 0;
+  int64_t failedFrames = 0; // Detection threw, not counted as processed
+  int64_t droppedFrames = 0; // Dropped from full queue
+  int64_t lateFrames = 0; // Processed after latency target
+  int64_t outOfOrderFrames = 0; // Processed after a newer frame of same stream
+  int64_t lastFrameId = -1; // Last processed frame
+
+  double totalLatencyMs = 0.0;
+  double maxLatencyMs = 0.0;
+
+  std::chrono::steady_clock::time_point firstSubmitTime;
+  std::chrono::steady_clock::time_point lastProcessTime;
+
+  double averageLatencyMs() const {
+    return processedFrames > 0 ? totalLatencyMs / processedFrames : 0.0;
+  }
+
+  double framesPerSecond() const {
+    const double seconds = std::chrono::duration<double>(lastProcessTime - firstSubmitTime).count();
+    return seconds > 0.0 ? processedFrames / seconds : 0.0;
+  }
+};
+
+// Camera stream with its own detectors, buffers and config
+// Frames of one stream are processed in order, one at a time
+class Stream {
+public:
+  int id;
+  int width;
+  int height;
+  int latencyTargetMs; // Frames should be processed in this time
+  size_t maxQueuedFrames; // Oldest frame is dropped when queue is full
+
+  std::atomic<int> modeIndex;
+
+  std::vector<Detector*> detectors; // Detectors in preview mode order
+
+  Export_Channel *exportChannel; // Results to exporter when it is running
+
+  // Called on worker thread after each detected frame
+  std::function<void(Stream &stream, Detector &detector, int64_t frameId)> onFrameDetected;
+
+  Stream(int id_, int width_, int height_, int modeIndex_, int latencyTargetMs_, size_t maxQueuedFrames_) {
+    id = id_;
+    width = width_;
+    height = height_;
+    modeIndex = 0;
+    latencyTargetMs = latencyTargetMs_;
+    maxQueuedFrames = std::max<size_t>(maxQueuedFrames_, 1);
+
+    detectors.push_back(new Detector_Edges_Image_White());
+    detectors.push_back(new Detector_Edges_Image_Red());
+    detectors.push_back(new Detector_Edges_Image_Green());
+    detectors.push_back(new Detector_Edges_Image_Blue());
+    detectors.push_back(new Detector_Edges_Image_Grayscale());
+    detectors.push_back(new Detector_Edges_Image_Background());
+    detectors.push_back(new Detector_Edges_Points());
+    detectors.push_back(new Detector_Edges_Points());
+
+    for (Detector *detector : detectors) {
+      detector->setImageSize(width, height);
+      detector->init();
+    }
+
+    // Invalid mode keeps first mode, creators check isValidMode
+    setMode(modeIndex_);
+
+    exportChannel = exporter.createChannel(id);
+  }
+
+  ~Stream() {
+    exporter.removeChannel(exportChannel);
+
+    for (Detector *detector : detectors) {
+      delete detector;
+    }
+
+    for (Stream_Frame *frame : queue) {
+      delete frame;
+    }
+
+    for (Stream_Frame *frame : freeFrames) {
+      delete frame;
+    }
+  }
+
+  bool isValidMode(int index) const {
+    return index >= 0 && index < (int)detectors.size();
+  }
+
+  void setMode(int index) {
+    if (isValidMode(index)) {
+      modeIndex = index;
+    }
+  }
+
+  void setRegions(const std::vector<cv::Rect> &regions, bool cachedBackground) {
+    for (Detector *detector : detectors) {
+      detector->cachedRegionBackground = cachedBackground;
+      detector->setRegions(regions);
+    }
+  }
+
+  void setRegionMask(const cv::Mat &mask, bool cachedBackground) {
+    for (Detector *detector : detectors) {
+      detector->cachedRegionBackground = cachedBackground;
+      detector->setRegionMask(mask);
+    }
+  }
+
+  // Negative mode index sets every mode
+  void setQualityTier(int index, int tier) {
+    for (int i = 0; i < (int)detectors.size(); ++i) {
+      if (index < 0 || index == i) {
+        detectors[i]->setQualityTier(tier);
+      }
+    }
+  }
+
+  size_t getFrameSize() const {
+    return (size_t)width * height * 3 / 2;
+  }
+
+  void processFrame(Stream_Frame *frame) {
+    Detector *detector = detectors.at(modeIndex);
+
+    detector->setImageData(frame->nv21ImageData.data());
+    detector->detect();
+
+    exporter.exportFrame(exportChannel, *detector, frame->frameId);
+
+    if (onFrameDetected) {
+      onFrameDetected(*this, *detector, frame->frameId);
+    }
+
+    detector->clearImage();
+  }
+
+private:
+  friend class Worker_Pool;
+
+  // Guarded by worker pool
+  std::deque<Stream_Frame*> queue;
+  std::vector<Stream_Frame*> freeFrames; // Reused frame buffers
+  int64_t nextFrameId = 0;
+  bool busy = false;
+  bool removed = false; // New frames are refused
+  Stream_Stats stats;
+};
@@ -0,0 +1,131 @@
+// Detects row stripes on its own thread while the frame is still being ingested
+// Frame latency approaches max(copy, detect) instead of copy + detect
+class Stripe_Pipeline {
+public:
+  int stripeHeight = 64;
+
+  ~Stripe_Pipeline() {
+    stop();
+  }
+
+  void start() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running) {
+      return;
+    }
+
+    running = true;
+
+    // Stripes are profiled like frames of the starting thread
+    const bool profiled = profiler.isThreadProfiled();
+
+    consumerThread = std::thread([this, profiled] {
+      profiler.setThreadProfiled(profiled);
+      consumerLoop();
+    });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (!running) {
+        return;
+      }
+
+      running = false;
+    }
+
+    condition.notify_all();
+    consumerThread.join();
+  }
+
+  // Called by ingestion thread before first row is copied, detector image must be wrapped and stripes prepared
+  void beginFrame(Detector *detector) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    frameDetector = detector;
+    rowsReady = 0;
+    frameDone = false;
+
+    condition.notify_all();
+  }
+
+  // Rows from top that are copied
+  void publishRows(int rows) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      rowsReady = rows;
+    }
+
+    condition.notify_all();
+  }
+
+  // Wait until every stripe is detected
+  void endFrame() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    doneCondition.wait(lock, [this] { return frameDone; });
+    frameDetector = nullptr;
+  }
+
+private:
+  std::thread consumerThread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::condition_variable doneCondition;
+  bool running = false;
+
+  Detector *frameDetector = nullptr;
+  int rowsReady = 0;
+  bool frameDone = true;
+
+  void consumerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      condition.wait(lock, [this] { return !running || (frameDetector != nullptr && !frameDone); });
+
+      if (!running) {
+        return;
+      }
+
+      Detector *detector = frameDetector;
+      const int width = detector->currentImage.cols;
+      const int height = detector->currentImage.rows;
+
+      lock.unlock();
+
+      try {
+        detector->beginStripes();
+
+        for (int y = 0; y < height; y += stripeHeight) {
+          const int stripeEnd = std::min(y + stripeHeight, height);
+          const int rowsNeeded = std::min(stripeEnd + detector->regionHalo, height);
+
+          // Wait for stripe rows and halo below it
+          lock.lock();
+          condition.wait(lock, [this, rowsNeeded] { return !running || rowsReady >= rowsNeeded; });
+
+          if (!running) {
+            return;
+          }
+
+          lock.unlock();
+
+          detector->detectStripe(cv::Rect(0, y, width, stripeEnd - y));
+        }
+
+        detector->endStripes();
+      }
+      catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_DEBUG, "edgedetector", "Stripe error: %s", e.what());
+      }
+
+      lock.lock();
+      frameDone = true;
+      doneCondition.notify_all();
+    }
+  }
+};
@@ -0,0 +1,272 @@
+// Shared threads that process frames from all streams
+// Idle stream whose oldest frame has the earliest deadline is scheduled next
+class Worker_Pool {
+public:
+  ~Worker_Pool() {
+    stop();
+  }
+
+  void start(int threadCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running) {
+      return;
+    }
+
+    running = true;
+
+    for (int i = 0; i < std::max(threadCount, 1); ++i) {
+      threads.push_back(std::thread(&Worker_Pool::workerLoop, this));
+    }
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      running = false;
+    }
+
+    condition.notify_all();
+
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    threads.clear();
+  }
+
+  // Stop scheduling and wait until processed frames are done, frames are still queued
+  void pause() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    paused = true;
+    idleCondition.wait(lock, [this] { return activeWorkers == 0; });
+  }
+
+  void resume() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      paused = false;
+    }
+
+    condition.notify_all();
+  }
+
+  void addStream(const std::shared_ptr<Stream> &stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+    streams.push_back(stream);
+  }
+
+  // Refuse new frames and wait until stream is not processed
+  // Stream is deleted when its last reference is released
+  void removeStream(int id) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    std::shared_ptr<Stream> stream = findStream(id);
+
+    if (!stream) {
+      return;
+    }
+
+    stream->removed = true;
+    streams.erase(std::remove(streams.begin(), streams.end(), stream), streams.end());
+
+    idleCondition.wait(lock, [&stream] { return !stream->busy; });
+  }
+
+  std::shared_ptr<Stream> getStream(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return findStream(id);
+  }
+
+  // Copy NV21 frame to stream queue, returns false if oldest frame was dropped or stream is removed
+  bool submit(Stream *stream, const unsigned char *nv21ImageData) {
+    const auto now = std::chrono::steady_clock::now();
+    Stream_Frame *frame = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      if (stream->removed) {
+        return false;
+      }
+
+      if (!stream->freeFrames.empty()) {
+        frame = stream->freeFrames.back();
+        stream->freeFrames.pop_back();
+      }
+    }
+
+    if (frame == nullptr) {
+      frame = new Stream_Frame();
+    }
+
+    // Copy outside of lock
+    frame->nv21ImageData.resize(stream->getFrameSize());
+    memcpy(frame->nv21ImageData.data(), nv21ImageData, frame->nv21ImageData.size());
+    frame->submitTime = now;
+
+    bool dropped = false;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      // Removed during copy, frame is deleted with stream
+      if (stream->removed) {
+        stream->freeFrames.push_back(frame);
+        return false;
+      }
+
+      if (stream->stats.submittedFrames == 0) {
+        stream->stats.firstSubmitTime = now;
+      }
+
+      frame->frameId = stream->nextFrameId++;
+      ++stream->stats.submittedFrames;
+
+      // Drop oldest frames when queue is full
+      while (stream->queue.size() >= stream->maxQueuedFrames) {
+        stream->freeFrames.push_back(stream->queue.front());
+        stream->queue.pop_front();
+        ++stream->stats.droppedFrames;
+        dropped = true;
+      }
+
+      stream->queue.push_back(frame);
+    }
+
+    condition.notify_one();
+
+    return !dropped;
+  }
+
+  Stream_Stats getStats(Stream *stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stream->stats;
+  }
+
+private:
+  std::vector<std::shared_ptr<Stream>> streams;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::condition_variable idleCondition;
+  size_t nextStreamIndex = 0; // Round robin start for equal deadlines
+  bool running = false;
+  bool paused = false;
+  int activeWorkers = 0; // Workers processing a frame
+
+  // Must be called with mutex locked
+  std::shared_ptr<Stream> findStream(int id) {
+    for (const std::shared_ptr<Stream> &stream : streams) {
+      if (stream->id == id) {
+        return stream;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Must be called with mutex locked
+  std::shared_ptr<Stream> nextStream() {
+    std::shared_ptr<Stream> selectedStream;
+    std::chrono::steady_clock::time_point selectedDeadline;
+
+    if (paused) {
+      return selectedStream;
+    }
+
+    for (size_t i = 0; i < streams.size(); ++i) {
+      const std::shared_ptr<Stream> &stream = streams[(nextStreamIndex + i) % streams.size()];
+
+      if (stream->busy || stream->queue.empty()) {
+        continue;
+      }
+
+      const auto deadline = stream->queue.front()->submitTime + std::chrono::milliseconds(stream->latencyTargetMs);
+
+      if (!selectedStream || deadline < selectedDeadline) {
+        selectedStream = stream;
+        selectedDeadline = deadline;
+      }
+    }
+
+    if (selectedStream != nullptr) {
+      nextStreamIndex = (nextStreamIndex + 1) % streams.size();
+    }
+
+    return selectedStream;
+  }
+
+  void workerLoop() {
+    profiler.setThreadProfiled(false);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      // Reference keeps stream alive while its frame is processed
+      std::shared_ptr<Stream> stream;
+
+      condition.wait(lock, [this, &stream] {
+        stream = nextStream();
+        return !running || stream;
+      });
+
+      if (!running) {
+        return;
+      }
+
+      Stream_Frame *frame = stream->queue.front();
+      stream->queue.pop_front();
+      stream->busy = true;
+      ++activeWorkers;
+
+      lock.unlock();
+
+      bool failed = false;
+
+      try {
+        stream->processFrame(frame);
+      }
+      catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_DEBUG, "edgedetector", "Stream %d error: %s", stream->id, e.what());
+        failed = true;
+      }
+
+      const auto now = std::chrono::steady_clock::now();
+      const double latencyMs = std::chrono::duration<double, std::milli>(now - frame->submitTime).count();
+
+      lock.lock();
+
+      Stream_Stats &stats = stream->stats;
+
+      if (failed) {
+        ++stats.failedFrames;
+      }
+      else {
+        ++stats.processedFrames;
+        stats.totalLatencyMs += latencyMs;
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+        stats.lastProcessTime = now;
+
+        if (latencyMs > stream->latencyTargetMs) {
+          ++stats.lateFrames;
+        }
+
+        if (frame->frameId < stats.lastFrameId) {
+          ++stats.outOfOrderFrames;
+        }
+
+        stats.lastFrameId = std::max(stats.lastFrameId, frame->frameId);
+      }
+
+      stream->freeFrames.push_back(frame);
+      stream->busy = false;
+      --activeWorkers;
+
+      // Stream may have more frames for another worker
+      condition.notify_one();
+      idleCondition.notify_all();
+    }
+  }
+};
@@ -332,6 +332,46 @@ class MyGLSurfaceView extends GLSurfaceView implements GLSurfaceView.Renderer {
                                            ByteBuffer u, int uSize, int uPixelStride, int uRowStride, 
                                            ByteBuffer v, int vSize, int vPixelStride, int vRowStride);
 
+    // Additional camera streams processed on a shared native worker pool, createStream returns -1 for an invalid mode
+    native public int createStream(int width, int height, int mode, int latencyTargetMs, int maxQueuedFrames);
+    native public void removeStream(int streamId);
+    native public void setStreamMode(int streamId, int mode);
+    native public boolean processStreamImageBuffer(int streamId, ByteBuffer nv21);
+    native public long[] getStreamStats(int streamId);
+
+    // Detect only inside x, y, width, height rects, stream id -1 is the preview
+    native public void setRegions(int streamId, int[] rects, boolean cachedBackground);
+
+    // Detect only in non-zero cells of a low resolution cols x rows mask scaled to each frame
+    native public void setRegionMask(int streamId, byte[] mask, int cols, int rows, boolean cachedBackground);
+
+    // Log per stage timing and hardware counters of native pipeline
+    native public void setProfilingEnabled(boolean enabled);
+
+    // Luma statistics computed while copying frames, used for Canny thresholds and skipping flat tiles
+    native public void setIngestStats(boolean enabled, boolean autoThresholds, boolean skipFlatTiles);
+
+    // Stream keypoints and edge masks to a Unix domain socket or file, path starting with @ is an abstract socket
+    native public boolean startExport(String path, boolean socket, boolean runLengthEncoding);
+    native public void stopExport();
+    native public long[] getExportStats();
+
+    // Detect row stripes of preview frame while it is still being copied
+    native public void setStripedDetectionEnabled(boolean enabled);
+
+    // Run whole image mode pipeline tile by tile in cache
+    native public void setTiledExecution(boolean enabled);
+
+    // Edge operator of image modes, 0 Canny, 1 Sobel with one threshold, 2 gradient lookup table
+    // Stream id -1 is the preview, mode -1 sets every mode
+    native public void setQualityTier(int streamId, int mode, int tier);
+
+    // Log native benchmark results
+    native public void runBenchmark();
+
+    // Log native self test results
+    native public void runSelfTest();
+
     private Context mContext;
 
     public MyGLSurfaceView(Context context) {